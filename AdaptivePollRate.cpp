@@ -0,0 +1,136 @@
+//
+//  CAdaptivePollRate
+//
+//  SoloCloudwatcher X2 plugin
+//  Picks the poll interval from how close the last readings are to their unsafe boundaries.
+
+#include "AdaptivePollRate.h"
+
+#include <math.h>
+#include <cmath>
+
+CAdaptivePollRate::CAdaptivePollRate()
+{
+    reset();
+}
+
+void CAdaptivePollRate::reset()
+{
+    m_SkyDelta.bValid = false;
+    m_Gust.bValid = false;
+    m_Humidity.bValid = false;
+    m_bHasLastUpdate = false;
+    m_dRisk = 0;
+    m_dInterval = 0;
+}
+
+// Risk is 0 far from every boundary and 1 at (or past) the closest one, either from the
+// current value or from where its trend will be ADAPTIVE_TREND_HORIZON seconds from now.
+// The interval is interpolated geometrically between the max (risk 0) and the min (risk 1).
+double CAdaptivePollRate::update(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, const AdaptiveLimits &limits, double dMinInterval, double dMaxInterval)
+{
+    Clock::time_point now = Clock::now();
+    double dElapsed = 0;
+    double dRisk = 0;
+    double dTarget;
+
+    if(dMaxInterval < dMinInterval)
+        dMaxInterval = dMinInterval;
+
+    if(m_bHasLastUpdate)
+        dElapsed = std::chrono::duration<double>(now - m_LastUpdate).count();
+    m_LastUpdate = now;
+    m_bHasLastUpdate = true;
+
+    if((nFieldMask & (FIELD_BIT(FIELD_CLOUDS) | FIELD_BIT(FIELD_TEMP))) == (FIELD_BIT(FIELD_CLOUDS) | FIELD_BIT(FIELD_TEMP)))
+        dRisk = fmax(dRisk, trendRisk(m_SkyDelta, record.dSkyTemp - record.dTemp, dElapsed, limits.dSkyDeltaUnsafe, limits.dSkyDeltaMargin));
+    else
+        m_SkyDelta.dAge += dElapsed;
+    if(nFieldMask & FIELD_BIT(FIELD_GUST))
+        dRisk = fmax(dRisk, trendRisk(m_Gust, record.dWindGust, dElapsed, limits.dGustUnsafe, limits.dGustMargin));
+    else
+        m_Gust.dAge += dElapsed;
+    if(nFieldMask & FIELD_BIT(FIELD_HUM))
+        dRisk = fmax(dRisk, trendRisk(m_Humidity, double(record.nPercentHumdity), dElapsed, limits.dHumidityUnsafe, limits.dHumidityMargin));
+    else
+        m_Humidity.dAge += dElapsed;
+
+    // the Solo reports 0 for unknown, 1 for dry, 2 and up for wet and rain
+    if((nFieldMask & FIELD_BIT(FIELD_RAIN_SAFE)) && record.nRainCondition > 1)
+        dRisk = 1.0;
+
+    m_dRisk = dRisk;
+    dTarget = dMaxInterval * pow(dMinInterval / dMaxInterval, dRisk);
+
+    // speed up at once, back off progressively so a reading hovering near a boundary doesn't oscillate
+    if(m_dInterval > 0 && dTarget > m_dInterval * ADAPTIVE_BACKOFF_FACTOR)
+        dTarget = m_dInterval * ADAPTIVE_BACKOFF_FACTOR;
+    m_dInterval = dTarget;
+
+    return m_dInterval;
+}
+
+void CAdaptivePollRate::defaultLimits(AdaptiveLimits &limits)
+{
+    limits.dSkyDeltaUnsafe = ADAPTIVE_SKY_DELTA_UNSAFE_DEFAULT;
+    limits.dSkyDeltaMargin = ADAPTIVE_SKY_DELTA_MARGIN_DEFAULT;
+    limits.dGustUnsafe = ADAPTIVE_GUST_UNSAFE_DEFAULT;
+    limits.dGustMargin = ADAPTIVE_GUST_MARGIN_DEFAULT;
+    limits.dHumidityUnsafe = ADAPTIVE_HUMIDITY_UNSAFE_DEFAULT;
+    limits.dHumidityMargin = ADAPTIVE_HUMIDITY_MARGIN_DEFAULT;
+}
+
+void CAdaptivePollRate::clampLimits(AdaptiveLimits &limits)
+{
+    AdaptiveLimits defaults;
+
+    defaultLimits(defaults);
+    if(!std::isfinite(limits.dSkyDeltaUnsafe))
+        limits.dSkyDeltaUnsafe = defaults.dSkyDeltaUnsafe;
+    if(!std::isfinite(limits.dGustUnsafe))
+        limits.dGustUnsafe = defaults.dGustUnsafe;
+    if(!std::isfinite(limits.dHumidityUnsafe))
+        limits.dHumidityUnsafe = defaults.dHumidityUnsafe;
+    limits.dSkyDeltaMargin = std::isfinite(limits.dSkyDeltaMargin) ? fmax(limits.dSkyDeltaMargin, 1.0) : defaults.dSkyDeltaMargin;
+    limits.dGustMargin = std::isfinite(limits.dGustMargin) ? fmax(limits.dGustMargin, 1.0) : defaults.dGustMargin;
+    limits.dHumidityMargin = std::isfinite(limits.dHumidityMargin) ? fmax(limits.dHumidityMargin, 1.0) : defaults.dHumidityMargin;
+}
+
+double CAdaptivePollRate::trendRisk(Trend &trend, double dValue, double dElapsed, double dUnsafe, double dMargin)
+{
+    double dSlope;
+    double dProjected;
+
+    // measuring over a fixed window keeps sensor noise from looking like a trend at fast poll rates
+    if(!trend.bValid) {
+        trend.dReference = dValue;
+        trend.dAge = 0;
+        trend.dSlope = 0;
+        trend.bValid = true;
+    }
+    else {
+        trend.dAge += dElapsed;
+        if(trend.dAge >= ADAPTIVE_TREND_WINDOW) {
+            dSlope = (dValue - trend.dReference) / trend.dAge;
+            trend.dSlope += ADAPTIVE_TREND_SMOOTHING * (dSlope - trend.dSlope);
+            trend.dReference = dValue;
+            trend.dAge = 0;
+        }
+    }
+
+    // only a trend toward the boundary counts
+    dProjected = dValue + fmax(trend.dSlope, 0.0) * ADAPTIVE_TREND_HORIZON;
+
+    return fmax(proximity(dValue, dUnsafe, dMargin), proximity(dProjected, dUnsafe, dMargin));
+}
+
+double CAdaptivePollRate::proximity(double dValue, double dUnsafe, double dMargin)
+{
+    double dRisk = 1.0 - (dUnsafe - dValue) / dMargin;
+
+    if(dRisk < 0)
+        return 0;
+    if(dRisk > 1)
+        return 1;
+    return dRisk;
+}
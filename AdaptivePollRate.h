@@ -0,0 +1,76 @@
+//
+//  CAdaptivePollRate
+//
+//  SoloCloudwatcher X2 plugin
+//  Picks the poll interval from how close the last readings are to their unsafe boundaries.
+
+#ifndef __AdaptivePollRate__
+#define __AdaptivePollRate__
+
+#include "CloudwatcherParser.h"
+#include "MonoClock.h"
+
+#define ADAPTIVE_INTERVAL_MIN_DEFAULT   1.0     // seconds
+#define ADAPTIVE_INTERVAL_MAX_DEFAULT   30.0    // seconds
+
+// the rate ramps up over the margin below each unsafe boundary
+#define ADAPTIVE_SKY_DELTA_UNSAFE_DEFAULT   -15.0   // ºC, sky minus ambient above this is cloudy
+#define ADAPTIVE_SKY_DELTA_MARGIN_DEFAULT   10.0    // ºC
+#define ADAPTIVE_GUST_UNSAFE_DEFAULT        40.0    // km/h
+#define ADAPTIVE_GUST_MARGIN_DEFAULT        25.0    // km/h
+#define ADAPTIVE_HUMIDITY_UNSAFE_DEFAULT    90.0    // %
+#define ADAPTIVE_HUMIDITY_MARGIN_DEFAULT    15.0    // %
+
+#define ADAPTIVE_TREND_HORIZON          300.0   // seconds, trends are extrapolated this far ahead
+#define ADAPTIVE_TREND_WINDOW           60.0    // seconds, slopes are measured over at least this long
+#define ADAPTIVE_TREND_SMOOTHING        0.5     // EWMA weight of the newest slope
+#define ADAPTIVE_BACKOFF_FACTOR         1.5     // max interval growth per poll, shrinking is immediate
+
+// the boundaries should match the limits the device itself is set to flag unsafe with
+struct AdaptiveLimits
+{
+    double  dSkyDeltaUnsafe;    // ºC
+    double  dSkyDeltaMargin;
+    double  dGustUnsafe;        // km/h
+    double  dGustMargin;
+    double  dHumidityUnsafe;    // %
+    double  dHumidityMargin;
+};
+
+class CAdaptivePollRate
+{
+public:
+    CAdaptivePollRate();
+
+    void        reset();
+    // only the fields in nFieldMask are taken from record, the others keep their trend as it was
+    double      update(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, const AdaptiveLimits &limits, double dMinInterval, double dMaxInterval);
+    static void defaultLimits(AdaptiveLimits &limits);
+    // margins are at least 1, an unsafe boundary can be anything finite
+    static void clampLimits(AdaptiveLimits &limits);
+    double      getRisk() { return m_dRisk; }
+
+protected:
+    typedef CMonoClock::Clock Clock;
+
+    struct Trend
+    {
+        double  dReference; // value at the start of the current slope window
+        double  dAge;       // seconds since dReference
+        double  dSlope;     // units per second, smoothed
+        bool    bValid;
+    };
+
+    Trend               m_SkyDelta;
+    Trend               m_Gust;
+    Trend               m_Humidity;
+    Clock::time_point   m_LastUpdate;
+    bool                m_bHasLastUpdate;
+    double              m_dRisk;
+    double              m_dInterval;
+
+    double      trendRisk(Trend &trend, double dValue, double dElapsed, double dUnsafe, double dMargin);
+    static double proximity(double dValue, double dUnsafe, double dMargin);
+};
+
+#endif
@@ -0,0 +1,55 @@
+//
+//  CClockOffset
+//
+//  SoloCloudwatcher X2 plugin
+//  Offset between the device clock and ours, estimated NTP style from the request midpoints,
+//  so a sample's device timestamp gives its true age on our clock.
+
+#include "ClockOffset.h"
+
+#include <math.h>
+
+CClockOffset::CClockOffset()
+{
+    reset();
+}
+
+void CClockOffset::reset()
+{
+    m_nCount = 0;
+    m_nNext = 0;
+    m_bValid = false;
+    m_dOffsetMs = 0;
+    m_dUncertaintyMs = 0;
+}
+
+// NTP takes the device time as read at the request midpoint. The Solo only reports when it
+// last sampled its sensors, which is at or before the request, so each sample's offset is a
+// lower bound of the real one. The largest over the window comes from the sample taken
+// closest to its request and is the estimate, give or take half that request's delay.
+void CClockOffset::add(int64_t nDeviceTimeMs, double dMidpointMs, double dDelayMs)
+{
+    size_t i;
+    size_t nBest = 0;
+
+    m_Samples[m_nNext].dOffset = double(nDeviceTimeMs) - dMidpointMs;
+    m_Samples[m_nNext].dDelay = dDelayMs > 0 ? dDelayMs : 0;
+    m_nNext = (m_nNext + 1) % CLOCK_OFFSET_WINDOW;
+    if(m_nCount < CLOCK_OFFSET_WINDOW)
+        m_nCount++;
+
+    for(i = 1; i < m_nCount; i++) {
+        if(m_Samples[i].dOffset > m_Samples[nBest].dOffset)
+            nBest = i;
+    }
+    m_dOffsetMs = m_Samples[nBest].dOffset;
+    m_dUncertaintyMs = m_Samples[nBest].dDelay / 2.0;
+    m_bValid = true;
+}
+
+int64_t CClockOffset::getAge(int64_t nDeviceTimeMs, int64_t nNowMs) const
+{
+    double dAge = double(nNowMs) + getOffset() - double(nDeviceTimeMs);
+
+    return dAge > 0 ? int64_t(llround(dAge)) : 0;
+}
@@ -0,0 +1,49 @@
+//
+//  CClockOffset
+//
+//  SoloCloudwatcher X2 plugin
+//  Offset between the device clock and ours, estimated NTP style from the request midpoints,
+//  so a sample's device timestamp gives its true age on our clock.
+
+#ifndef __ClockOffset__
+#define __ClockOffset__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define CLOCK_OFFSET_WINDOW     64      // samples the estimate is taken over
+
+class CClockOffset
+{
+public:
+    CClockOffset();
+
+    void        reset();
+    // writer only : nDeviceTimeMs is a new sample's timestamp on the device clock, dMidpointMs and
+    // dDelayMs the middle and length of the request that returned it, on our system_clock
+    void        add(int64_t nDeviceTimeMs, double dMidpointMs, double dDelayMs);
+
+    bool        isValid() const { return m_bValid.load(std::memory_order_relaxed); }
+    double      getOffset() const { return m_dOffsetMs.load(std::memory_order_relaxed); }            // ms, device - host
+    double      getUncertainty() const { return m_dUncertaintyMs.load(std::memory_order_relaxed); }  // ms
+    // ms, age on our clock of a sample stamped nDeviceTimeMs, never negative
+    int64_t     getAge(int64_t nDeviceTimeMs, int64_t nNowMs) const;
+
+protected:
+    struct Sample
+    {
+        double  dOffset;
+        double  dDelay;
+    };
+
+    Sample      m_Samples[CLOCK_OFFSET_WINDOW];
+    size_t      m_nCount;
+    size_t      m_nNext;
+
+    std::atomic<bool>   m_bValid;
+    std::atomic<double> m_dOffsetMs;
+    std::atomic<double> m_dUncertaintyMs;
+};
+
+#endif
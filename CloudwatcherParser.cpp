@@ -0,0 +1,367 @@
+//
+//  CCloudwatcherParser
+//
+//  SoloCloudwatcher X2 plugin
+//  Single pass, allocation free parser for the cgiLastData key=value body.
+
+#include "CloudwatcherParser.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+
+#define KEY_ENTRY(sKey, nField)   { sKey, sizeof(sKey) - 1, nField }
+
+struct FieldKey
+{
+    const char  *pszKey;
+    size_t      nLen;
+    int         nField;
+};
+
+// the table is built at compile time, lookups compare the length before the bytes
+static const FieldKey s_FieldKeys[FIELD_COUNT] = {
+    KEY_ENTRY("cwinfo",         FIELD_CWINFO),
+    KEY_ENTRY("cloudsSafe",     FIELD_CLOUDS_SAFE),
+    KEY_ENTRY("clouds",         FIELD_CLOUDS),
+    KEY_ENTRY("temp",           FIELD_TEMP),
+    KEY_ENTRY("wind",           FIELD_WIND),
+    KEY_ENTRY("windSafe",       FIELD_WIND_SAFE),
+    KEY_ENTRY("gust",           FIELD_GUST),
+    KEY_ENTRY("rainSafe",       FIELD_RAIN_SAFE),
+    KEY_ENTRY("lightSafe",      FIELD_LIGHT_SAFE),
+    KEY_ENTRY("safe",           FIELD_SAFE),
+    KEY_ENTRY("hum",            FIELD_HUM),
+    KEY_ENTRY("humSafe",        FIELD_HUM_SAFE),
+    KEY_ENTRY("dewp",           FIELD_DEWP),
+    KEY_ENTRY("relpress",       FIELD_RELPRESS),
+    KEY_ENTRY("pressureSafe",   FIELD_PRESSURE_SAFE),
+};
+
+// exact powers of ten, any value up to 1e22 is representable in a double
+static const double s_dPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+bool CCloudwatcherParser::parse(const char *pBuf, size_t nLen, SoloCloudwatcherRecord &record)
+{
+    const char *pCur = pBuf;
+    const char *pEnd = pBuf + nLen;
+    const char *pEol;
+    const char *pSep;
+    const char *pValueEnd;
+    int nField;
+
+    record.nFieldMask = 0;
+
+    if(!pBuf || !nLen)
+        return false;
+
+    while(pCur < pEnd) {
+        pEol = (const char *)memchr(pCur, '\n', pEnd - pCur);
+        if(!pEol)
+            pEol = pEnd;
+
+        pSep = (const char *)memchr(pCur, '=', pEol - pCur);
+        if(pSep) {
+            pValueEnd = pEol;
+            if(pValueEnd > pSep + 1 && *(pValueEnd - 1) == '\r')
+                pValueEnd--;
+            nField = findField(pCur, pSep - pCur);
+            if(nField >= 0 && storeField(nField, pSep + 1, pValueEnd, record))
+                record.nFieldMask |= FIELD_BIT(nField);
+        }
+        pCur = pEol + 1;
+    }
+
+    return (record.nFieldMask & FIELD_MASK_REQUIRED) == FIELD_MASK_REQUIRED;
+}
+
+bool CCloudwatcherParser::findValue(const char *pBuf, size_t nLen, const char *pszKey, const char *&pStart, const char *&pEnd)
+{
+    const char *pCur = pBuf;
+    const char *pBufEnd = pBuf + nLen;
+    const char *pEol;
+    size_t nKeyLen = strlen(pszKey);
+
+    if(!pBuf)
+        return false;
+
+    while(pCur < pBufEnd) {
+        pEol = (const char *)memchr(pCur, '\n', pBufEnd - pCur);
+        if(!pEol)
+            pEol = pBufEnd;
+        if(size_t(pEol - pCur) > nKeyLen && pCur[nKeyLen] == '=' && !memcmp(pCur, pszKey, nKeyLen)) {
+            pStart = pCur + nKeyLen + 1;
+            pEnd = pEol;
+            if(pEnd > pStart && *(pEnd - 1) == '\r')
+                pEnd--;
+            return true;
+        }
+        pCur = pEol + 1;
+    }
+    return false;
+}
+
+// FNV-1a, a Solo body is a few hundred bytes so this costs well under a microsecond
+uint64_t CCloudwatcherParser::fingerprint(const char *pBuf, size_t nLen)
+{
+    uint64_t nHash = 14695981039346656037ULL;
+    size_t i;
+
+    for(i = 0; i < nLen; i++) {
+        nHash ^= (uint8_t)pBuf[i];
+        nHash *= 1099511628211ULL;
+    }
+    return nHash;
+}
+
+void CCloudwatcherParser::merge(const SoloCloudwatcherRecord &from, SoloCloudwatcherRecord &to)
+{
+    uint32_t nMask = from.nFieldMask;
+
+    if(nMask & FIELD_BIT(FIELD_CWINFO))         memcpy(to.sFirmware, from.sFirmware, FIRMWARE_MAX_LEN);
+    if(nMask & FIELD_BIT(FIELD_CLOUDS_SAFE))    to.nCloudCondition = from.nCloudCondition;
+    if(nMask & FIELD_BIT(FIELD_CLOUDS))         to.dSkyTemp = from.dSkyTemp;
+    if(nMask & FIELD_BIT(FIELD_TEMP))           to.dTemp = from.dTemp;
+    if(nMask & FIELD_BIT(FIELD_WIND))           to.dWindSpeed = from.dWindSpeed;
+    if(nMask & FIELD_BIT(FIELD_WIND_SAFE))      to.nWindCondition = from.nWindCondition;
+    if(nMask & FIELD_BIT(FIELD_GUST))           to.dWindGust = from.dWindGust;
+    if(nMask & FIELD_BIT(FIELD_RAIN_SAFE))      to.nRainCondition = from.nRainCondition;
+    if(nMask & FIELD_BIT(FIELD_LIGHT_SAFE))     to.nLightCondition = from.nLightCondition;
+    if(nMask & FIELD_BIT(FIELD_SAFE))           to.nOverallConditionSafe = from.nOverallConditionSafe;
+    if(nMask & FIELD_BIT(FIELD_HUM))            to.nPercentHumdity = from.nPercentHumdity;
+    if(nMask & FIELD_BIT(FIELD_HUM_SAFE))       to.nHumdityCondition = from.nHumdityCondition;
+    if(nMask & FIELD_BIT(FIELD_DEWP))           to.dDewPointTemp = from.dDewPointTemp;
+    if(nMask & FIELD_BIT(FIELD_RELPRESS))       to.dBarometricPressure = from.dBarometricPressure;
+    if(nMask & FIELD_BIT(FIELD_PRESSURE_SAFE))  to.nBarometricPressureCondition = from.nBarometricPressureCondition;
+    to.nFieldMask |= nMask;
+}
+
+int CCloudwatcherParser::findField(const char *pKey, size_t nKeyLen)
+{
+    int i;
+
+    for(i = 0; i < FIELD_COUNT; i++) {
+        if(s_FieldKeys[i].nLen == nKeyLen && !memcmp(s_FieldKeys[i].pszKey, pKey, nKeyLen))
+            return s_FieldKeys[i].nField;
+    }
+    return -1;
+}
+
+bool CCloudwatcherParser::storeField(int nField, const char *pStart, const char *pEnd, SoloCloudwatcherRecord &record)
+{
+    size_t nLen;
+
+    switch(nField) {
+        case FIELD_CWINFO:
+            nLen = pEnd - pStart;
+            if(nLen >= FIRMWARE_MAX_LEN)
+                nLen = FIRMWARE_MAX_LEN - 1;
+            memcpy(record.sFirmware, pStart, nLen);
+            record.sFirmware[nLen] = 0;
+            return true;
+        case FIELD_CLOUDS_SAFE:     return parseInt(pStart, pEnd, record.nCloudCondition);
+        case FIELD_CLOUDS:          return parseDouble(pStart, pEnd, record.dSkyTemp);
+        case FIELD_TEMP:            return parseDouble(pStart, pEnd, record.dTemp);
+        case FIELD_WIND:            return parseDouble(pStart, pEnd, record.dWindSpeed);
+        case FIELD_WIND_SAFE:       return parseInt(pStart, pEnd, record.nWindCondition);
+        case FIELD_GUST:            return parseDouble(pStart, pEnd, record.dWindGust);
+        case FIELD_RAIN_SAFE:       return parseInt(pStart, pEnd, record.nRainCondition);
+        case FIELD_LIGHT_SAFE:      return parseInt(pStart, pEnd, record.nLightCondition);
+        case FIELD_SAFE:            return parseInt(pStart, pEnd, record.nOverallConditionSafe);
+        case FIELD_HUM:             return parseInt(pStart, pEnd, record.nPercentHumdity);
+        case FIELD_HUM_SAFE:        return parseInt(pStart, pEnd, record.nHumdityCondition);
+        case FIELD_DEWP:            return parseDouble(pStart, pEnd, record.dDewPointTemp);
+        case FIELD_RELPRESS:        return parseDouble(pStart, pEnd, record.dBarometricPressure);
+        case FIELD_PRESSURE_SAFE:   return parseInt(pStart, pEnd, record.nBarometricPressureCondition);
+        default:
+            return false;
+    }
+}
+
+// Dashes and a T are taken as well as the slashes and the space. Days from the civil date
+// the way timegm would, which isn't portable.
+bool CCloudwatcherParser::parseDataTime(const char *pStart, const char *pEnd, int64_t &nTimeMs)
+{
+    const char *p = pStart;
+    int nYear, nMonth, nDay, nHour, nMinute, nSecond;
+    int nMs = 0;
+    int nScale = 100;
+    int64_t nYearOfEra, nDayOfYear, nDayOfEra, nEra, nDays;
+
+    while(p < pEnd && (*p == ' ' || *p == '\t'))
+        p++;
+    if(!parseDigits(p, pEnd, 4, nYear) || p == pEnd || (*p != '/' && *p != '-'))
+        return false;
+    p++;
+    if(!parseDigits(p, pEnd, 2, nMonth) || p == pEnd || (*p != '/' && *p != '-'))
+        return false;
+    p++;
+    if(!parseDigits(p, pEnd, 2, nDay) || p == pEnd || (*p != ' ' && *p != 'T'))
+        return false;
+    p++;
+    if(!parseDigits(p, pEnd, 2, nHour) || p == pEnd || *p != ':')
+        return false;
+    p++;
+    if(!parseDigits(p, pEnd, 2, nMinute) || p == pEnd || *p != ':')
+        return false;
+    p++;
+    if(!parseDigits(p, pEnd, 2, nSecond))
+        return false;
+    if(p < pEnd && *p == '.') {
+        for(p++; p < pEnd && *p >= '0' && *p <= '9'; p++) {
+            nMs += (*p - '0') * nScale;
+            nScale /= 10;
+        }
+    }
+    if(nMonth < 1 || nMonth > 12 || nDay < 1 || nDay > 31 || nHour > 23 || nMinute > 59 || nSecond > 60)
+        return false;
+
+    nYear -= nMonth <= 2;
+    nEra = nYear / 400;
+    nYearOfEra = nYear - nEra * 400;
+    nDayOfYear = (153 * (nMonth + (nMonth > 2 ? -3 : 9)) + 2) / 5 + nDay - 1;
+    nDayOfEra = nYearOfEra * 365 + nYearOfEra / 4 - nYearOfEra / 100 + nDayOfYear;
+    nDays = nEra * 146097 + nDayOfEra - 719468;
+
+    nTimeMs = ((nDays * 24 + nHour) * 60 + nMinute) * 60000LL + nSecond * 1000LL + nMs;
+    return true;
+}
+
+// exactly nDigits digits, p is left after them
+bool CCloudwatcherParser::parseDigits(const char *&p, const char *pEnd, int nDigits, int &nValue)
+{
+    int i;
+
+    nValue = 0;
+    for(i = 0; i < nDigits; i++, p++) {
+        if(p == pEnd || *p < '0' || *p > '9')
+            return false;
+        nValue = nValue * 10 + (*p - '0');
+    }
+    return true;
+}
+
+// Same acceptance as std::stoi : leading blanks, optional sign, at least one digit,
+// anything after the digits (like a ".0") is ignored.
+bool CCloudwatcherParser::parseInt(const char *pStart, const char *pEnd, int &nValue)
+{
+    const char *p = pStart;
+    bool bNegative = false;
+    long long nAcc = 0;
+
+    while(p < pEnd && (*p == ' ' || *p == '\t'))
+        p++;
+    if(p < pEnd && (*p == '-' || *p == '+')) {
+        bNegative = (*p == '-');
+        p++;
+    }
+    if(p == pEnd || *p < '0' || *p > '9')
+        return false;
+
+    while(p < pEnd && *p >= '0' && *p <= '9') {
+        nAcc = nAcc * 10 + (*p - '0');
+        if(nAcc > 2147483648LL)
+            return false;
+        p++;
+    }
+    if(bNegative)
+        nAcc = -nAcc;
+    if(nAcc > 2147483647LL)
+        return false;
+
+    nValue = (int)nAcc;
+    return true;
+}
+
+// Decimal to double without locale or allocation : up to 19 significant digits are
+// accumulated in an integer and scaled once by an exact power of ten.
+bool CCloudwatcherParser::parseDouble(const char *pStart, const char *pEnd, double &dValue)
+{
+    const char *p = pStart;
+    bool bNegative = false;
+    bool bExpNegative = false;
+    uint64_t nMantissa = 0;
+    int nDigits = 0;
+    int nSignificant = 0;
+    int nExp10 = 0;
+    int nExp = 0;
+    double dResult;
+
+    while(p < pEnd && (*p == ' ' || *p == '\t'))
+        p++;
+    if(p < pEnd && (*p == '-' || *p == '+')) {
+        bNegative = (*p == '-');
+        p++;
+    }
+
+    while(p < pEnd && *p >= '0' && *p <= '9') {
+        if(nSignificant < 19) {
+            nMantissa = nMantissa * 10 + (*p - '0');
+            if(nMantissa)
+                nSignificant++;
+        }
+        else
+            nExp10++;
+        nDigits++;
+        p++;
+    }
+    if(p < pEnd && *p == '.') {
+        p++;
+        while(p < pEnd && *p >= '0' && *p <= '9') {
+            if(nSignificant < 19) {
+                nMantissa = nMantissa * 10 + (*p - '0');
+                if(nMantissa)
+                    nSignificant++;
+                nExp10--;
+            }
+            nDigits++;
+            p++;
+        }
+    }
+    if(!nDigits)
+        return false;
+
+    if(p < pEnd && (*p == 'e' || *p == 'E')) {
+        const char *pExp = p + 1;
+        if(pExp < pEnd && (*pExp == '-' || *pExp == '+')) {
+            bExpNegative = (*pExp == '-');
+            pExp++;
+        }
+        if(pExp < pEnd && *pExp >= '0' && *pExp <= '9') {
+            while(pExp < pEnd && *pExp >= '0' && *pExp <= '9') {
+                if(nExp < 10000)
+                    nExp = nExp * 10 + (*pExp - '0');
+                pExp++;
+            }
+            nExp10 += bExpNegative ? -nExp : nExp;
+        }
+    }
+
+    dResult = (double)nMantissa;
+    if(nExp10 < 0 && nExp10 >= -22)
+        dResult /= s_dPow10[-nExp10];
+    else if(nExp10 > 0 && nExp10 <= 22)
+        dResult *= s_dPow10[nExp10];
+    else if(nExp10)
+        dResult *= pow(10.0, nExp10);
+
+    dValue = bNegative ? -dResult : dResult;
+    return true;
+}
+
+void CCloudwatcherParser::formatFixed2(char *pszBuf, size_t nSize, double dValue, const char *pszUnit)
+{
+    long long nCents;
+
+    if(!std::isfinite(dValue) || fabs(dValue) > 1e15) {
+        snprintf(pszBuf, nSize, "N/A");
+        return;
+    }
+
+    nCents = llround(fabs(dValue) * 100.0);
+    snprintf(pszBuf, nSize, "%s%lld.%02lld%s", (dValue < 0 && nCents)?"-":"", nCents / 100, nCents % 100, pszUnit);
+}
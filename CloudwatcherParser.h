@@ -0,0 +1,91 @@
+//
+//  CCloudwatcherParser
+//
+//  SoloCloudwatcher X2 plugin
+//  Single pass, allocation free parser for the cgiLastData key=value body.
+
+#ifndef __CloudwatcherParser__
+#define __CloudwatcherParser__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FIRMWARE_MAX_LEN    64
+#define DATA_TIME_KEY       "dataGMTTime"   // when the device last updated its readings, not parsed into the record
+
+// one bit per cgiLastData key in SoloCloudwatcherRecord::nFieldMask
+enum SoloCloudwatcherFields {
+    FIELD_CWINFO = 0,
+    FIELD_CLOUDS_SAFE,
+    FIELD_CLOUDS,
+    FIELD_TEMP,
+    FIELD_WIND,
+    FIELD_WIND_SAFE,
+    FIELD_GUST,
+    FIELD_RAIN_SAFE,
+    FIELD_LIGHT_SAFE,
+    FIELD_SAFE,
+    FIELD_HUM,
+    FIELD_HUM_SAFE,
+    FIELD_DEWP,
+    FIELD_RELPRESS,
+    FIELD_PRESSURE_SAFE,
+    FIELD_COUNT
+};
+
+#define FIELD_BIT(f)            (1u << (f))
+#define FIELD_MASK_ALL          (FIELD_BIT(FIELD_COUNT) - 1u)
+// cwinfo is informative only, every other key is needed for a usable sample
+#define FIELD_MASK_REQUIRED     (FIELD_MASK_ALL & ~FIELD_BIT(FIELD_CWINFO))
+// the conditions TheSkyX closes the roof on, a reading is only as good as the oldest of them
+#define FIELD_MASK_SAFETY       (FIELD_BIT(FIELD_CLOUDS_SAFE) | FIELD_BIT(FIELD_WIND_SAFE) | FIELD_BIT(FIELD_RAIN_SAFE) | FIELD_BIT(FIELD_LIGHT_SAFE) | FIELD_BIT(FIELD_SAFE))
+
+struct SoloCloudwatcherRecord
+{
+    char        sFirmware[FIRMWARE_MAX_LEN];    // cwinfo
+    int         nCloudCondition;                // cloudsSafe
+    double      dSkyTemp;                       // clouds
+    double      dTemp;                          // temp
+    double      dWindSpeed;                     // wind
+    int         nWindCondition;                 // windSafe
+    double      dWindGust;                      // gust
+    int         nRainCondition;                 // rainSafe
+    int         nLightCondition;                // lightSafe
+    int         nOverallConditionSafe;          // safe
+    int         nPercentHumdity;                // hum
+    int         nHumdityCondition;              // humSafe
+    double      dDewPointTemp;                  // dewp
+    double      dBarometricPressure;            // relpress
+    int         nBarometricPressureCondition;   // pressureSafe
+
+    uint32_t    nFieldMask;                     // FIELD_BIT() of every key parsed, the fields with a valid value
+};
+
+class CCloudwatcherParser
+{
+public:
+    // true when every required key was read, nFieldMask tells which ones were either way
+    static bool parse(const char *pBuf, size_t nLen, SoloCloudwatcherRecord &record);
+    // copies the fields valid in from over to, and adds them to to.nFieldMask
+    static void merge(const SoloCloudwatcherRecord &from, SoloCloudwatcherRecord &to);
+
+    // raw value of one key without parsing the rest, false if the key isn't in the body
+    static bool findValue(const char *pBuf, size_t nLen, const char *pszKey, const char *&pStart, const char *&pEnd);
+    // cheap 64 bit hash of a whole body, to tell a repeated response without parsing it
+    static uint64_t fingerprint(const char *pBuf, size_t nLen);
+
+    // dataGMTTime, "YYYY/MM/DD HH:MM:SS" UTC with optional fractional seconds, to ms since the epoch
+    static bool parseDataTime(const char *pStart, const char *pEnd, int64_t &nTimeMs);
+
+    static bool parseInt(const char *pStart, const char *pEnd, int &nValue);
+    static bool parseDouble(const char *pStart, const char *pEnd, double &dValue);
+    // two decimals and pszUnit, written by hand so the numeric locale can't change the separator, N/A if not finite
+    static void formatFixed2(char *pszBuf, size_t nSize, double dValue, const char *pszUnit);
+
+protected:
+    static int  findField(const char *pKey, size_t nKeyLen);
+    static bool storeField(int nField, const char *pStart, const char *pEnd, SoloCloudwatcherRecord &record);
+    static bool parseDigits(const char *&p, const char *pEnd, int nDigits, int &nValue);
+};
+
+#endif
@@ -0,0 +1,106 @@
+//
+//  CConnectionState
+//
+//  SoloCloudwatcher X2 plugin
+//  Link state of a station as seen by the poller, with exponential backoff and jitter
+//  between attempts while the device can't be reached. The state is one atomic word,
+//  so the X2 side reads it without locking or waiting on the device.
+
+#include "ConnectionState.h"
+
+#include <math.h>
+
+#include "Logger.h"
+
+static const char *s_pszStateNames[] = {"Closed", "Connecting", "Live", "Degraded", "Reconnecting"};
+
+CConnectionState::CConnectionState()
+{
+    m_nState = CONNECTION_CLOSED;
+    m_nFailures = 0;
+    m_nTransitions = 0;
+    m_nRetries = 0;
+    m_RetryDeadline = Clock::time_point();
+    m_Random.seed((unsigned int)Clock::now().time_since_epoch().count());
+}
+
+const char *CConnectionState::name(int nState)
+{
+    if(nState < CONNECTION_CLOSED || nState > CONNECTION_RECONNECTING)
+        return "Unknown";
+    return s_pszStateNames[nState];
+}
+
+void CConnectionState::open()
+{
+    m_nFailures = 0;
+    m_nRetries = 0;
+    m_RetryDeadline = Clock::time_point();
+    setState(CONNECTION_CONNECTING);
+}
+
+void CConnectionState::close()
+{
+    m_RetryDeadline = Clock::time_point();
+    setState(CONNECTION_CLOSED);
+}
+
+void CConnectionState::onSuccess()
+{
+    m_nFailures = 0;
+    m_nRetries = 0;
+    m_RetryDeadline = Clock::time_point();
+    setState(CONNECTION_LIVE);
+}
+
+// A live link rides out a few failed polls on its normal schedule before it is declared
+// lost. From then on, like before the first answer, attempts are spaced out by the backoff.
+void CConnectionState::onFailure()
+{
+    uint32_t nFailures = m_nFailures.load(std::memory_order_relaxed) + 1;
+
+    m_nFailures.store(nFailures, std::memory_order_relaxed);
+    switch(get()) {
+        case CONNECTION_LIVE:
+            setState(CONNECTION_DEGRADED);
+            break;
+        case CONNECTION_DEGRADED:
+            if(nFailures >= CONNECTION_DEGRADED_LIMIT) {
+                setState(CONNECTION_RECONNECTING);
+                scheduleRetry();
+            }
+            break;
+        case CONNECTION_CONNECTING:
+        case CONNECTION_RECONNECTING:
+            scheduleRetry();
+            break;
+        default:
+            break;
+    }
+}
+
+// CONNECTION_BACKOFF_MIN doubled per attempt up to CONNECTION_BACKOFF_MAX, with jitter
+void CConnectionState::scheduleRetry()
+{
+    std::uniform_real_distribution<double> jitter(1.0 - CONNECTION_BACKOFF_JITTER, 1.0 + CONNECTION_BACKOFF_JITTER);
+    double dDelay;
+
+    dDelay = CONNECTION_BACKOFF_MIN * pow(2.0, double(m_nRetries < 16 ? m_nRetries : 16));
+    if(dDelay > CONNECTION_BACKOFF_MAX)
+        dDelay = CONNECTION_BACKOFF_MAX;
+    dDelay *= jitter(m_Random);
+    m_nRetries++;
+
+    m_RetryDeadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dDelay));
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[CConnectionState] %s, retry %u in %.2f s", name(get()), m_nRetries, dDelay);
+}
+
+void CConnectionState::setState(int nState)
+{
+    int nOld = m_nState.exchange(nState, std::memory_order_relaxed);
+
+    if(nOld == nState)
+        return;
+    m_nTransitions.fetch_add(1, std::memory_order_relaxed);
+    SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[CConnectionState] %s -> %s", name(nOld), name(nState));
+}
@@ -0,0 +1,64 @@
+//
+//  CConnectionState
+//
+//  SoloCloudwatcher X2 plugin
+//  Link state of a station as seen by the poller, with exponential backoff and jitter
+//  between attempts while the device can't be reached. The state is one atomic word,
+//  so the X2 side reads it without locking or waiting on the device.
+
+#ifndef __ConnectionState__
+#define __ConnectionState__
+
+#include <stdint.h>
+#include <atomic>
+#include <random>
+
+#include "MonoClock.h"
+
+#define CONNECTION_DEGRADED_LIMIT   3       // failed polls in a row before a live link is considered lost
+#define CONNECTION_BACKOFF_MIN      1.0     // seconds, first retry delay
+#define CONNECTION_BACKOFF_MAX      60.0    // seconds
+#define CONNECTION_BACKOFF_JITTER   0.2     // +/- fraction of the delay, so stations don't retry in step
+
+// Connecting : no answer yet since Connect, retrying with backoff
+// Live : the last poll succeeded
+// Degraded : fewer than CONNECTION_DEGRADED_LIMIT polls in a row failed, polling on schedule
+// Reconnecting : the link was lost, retrying with backoff
+// Closed : disconnected
+enum ConnectionStates {CONNECTION_CLOSED=0, CONNECTION_CONNECTING, CONNECTION_LIVE, CONNECTION_DEGRADED, CONNECTION_RECONNECTING};
+
+class CConnectionState
+{
+public:
+    typedef CMonoClock::Clock Clock;
+
+    CConnectionState();
+
+    // writer side : Connect/Disconnect, then the engine thread
+    void        open();
+    void        close();
+    void        onSuccess();
+    void        onFailure();
+    // time of the next attempt while backing off, the epoch otherwise
+    Clock::time_point retryDeadline() { return m_RetryDeadline; }
+
+    int         get() const { return m_nState.load(std::memory_order_relaxed); }
+    uint32_t    getFailureCount() const { return m_nFailures.load(std::memory_order_relaxed); }
+    uint64_t    getTransitionCount() const { return m_nTransitions.load(std::memory_order_relaxed); }
+    static const char *name(int nState);
+
+protected:
+    void        setState(int nState);
+    void        scheduleRetry();
+
+    std::atomic<int>        m_nState;
+    std::atomic<uint32_t>   m_nFailures;        // failed polls in a row
+    std::atomic<uint64_t>   m_nTransitions;
+
+    // writer only
+    uint32_t                m_nRetries;         // backoff attempts since the last success
+    Clock::time_point       m_RetryDeadline;
+    std::minstd_rand        m_Random;
+};
+
+#endif
@@ -0,0 +1,113 @@
+//
+//  CDiskWriter
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide background thread for the slow disk work of every station.
+
+#include "DiskWriter.h"
+
+CDiskWriter &CDiskWriter::instance()
+{
+    static CDiskWriter writer;
+    return writer;
+}
+
+CDiskWriter::CDiskWriter()
+{
+    m_nUsers = 0;
+    m_bRunning = false;
+    m_bStop = false;
+    m_bBusy = false;
+}
+
+CDiskWriter::~CDiskWriter()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_Wake.notify_all();
+    if(m_Thread.joinable())
+        m_Thread.join();
+}
+
+void CDiskWriter::open()
+{
+    const std::lock_guard<std::mutex> lifecycle(m_LifecycleMutex);
+
+    if(m_nUsers++)
+        return;
+
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bStop = false;
+    m_bRunning = true;
+    m_Thread = std::thread(&threadEntry, this);
+}
+
+void CDiskWriter::close()
+{
+    const std::lock_guard<std::mutex> lifecycle(m_LifecycleMutex);
+
+    if(!m_nUsers || --m_nUsers)
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_Wake.notify_all();
+    // the thread empties the queue before exiting
+    m_Thread.join();
+}
+
+// Queued as long as the thread runs, even while the last close waits for it, so jobs keep
+// their order.
+void CDiskWriter::post(const std::function<void()> &job)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_Mutex);
+        if(m_bRunning) {
+            m_Jobs.push_back(job);
+            m_Wake.notify_one();
+            return;
+        }
+    }
+    job();
+}
+
+void CDiskWriter::drain()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    m_Idle.wait(lock, [this] { return m_Jobs.empty() && !m_bBusy; });
+}
+
+void CDiskWriter::threadEntry(CDiskWriter *pWriter)
+{
+    pWriter->run();
+}
+
+void CDiskWriter::run()
+{
+    std::function<void()> job;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while(true) {
+        m_Wake.wait(lock, [this] { return m_bStop || !m_Jobs.empty(); });
+        if(m_Jobs.empty())
+            break;
+
+        job = m_Jobs.front();
+        m_Jobs.pop_front();
+        m_bBusy = true;
+        lock.unlock();
+        job();
+        lock.lock();
+        m_bBusy = false;
+        if(m_Jobs.empty())
+            m_Idle.notify_all();
+    }
+
+    // under m_Mutex with the queue empty, a job posted from now on runs on its caller's thread
+    m_bRunning = false;
+}
@@ -0,0 +1,51 @@
+//
+//  CDiskWriter
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide background thread for the slow disk work of every station : archive syncs and
+//  snapshot saves run on it in order, never on the engine thread or under a station's mutex.
+
+#ifndef __DiskWriter__
+#define __DiskWriter__
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class CDiskWriter
+{
+public:
+    static CDiskWriter &instance();
+
+    // the thread runs while at least one user has the writer open, the last close runs what is queued first
+    void        open();
+    void        close();
+
+    // runs job on the writer thread after the ones posted before it, or right away when no one has the writer open
+    void        post(const std::function<void()> &job);
+    // returns once every job posted so far has run
+    void        drain();
+
+protected:
+    CDiskWriter();
+    ~CDiskWriter();
+
+    void        run();
+    static void threadEntry(CDiskWriter *pWriter);
+
+    std::mutex                          m_LifecycleMutex;   // serializes open / close
+    int                                 m_nUsers;
+
+    std::mutex                          m_Mutex;
+    std::condition_variable             m_Wake;
+    std::condition_variable             m_Idle;
+    std::deque<std::function<void()> >  m_Jobs;     // under m_Mutex
+    bool                                m_bRunning; // under m_Mutex
+    bool                                m_bStop;    // under m_Mutex
+    bool                                m_bBusy;    // under m_Mutex, a job is running
+    std::thread                         m_Thread;
+};
+
+#endif
@@ -0,0 +1,238 @@
+//
+//  CHistoryRing
+//
+//  SoloCloudwatcher X2 plugin
+//  Fixed capacity history of recent samples. One writer (the poller) appends, any number of
+//  readers query time ranges without locking or slowing the writer down.
+
+#include "HistoryRing.h"
+
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+
+static_assert(sizeof(HistorySample) == 64, "HistorySample is part of the archive format");
+static_assert(std::is_trivially_copyable<HistorySample>::value, "HistorySample is copied word by word");
+static_assert(FIELD_COUNT <= 16, "HistorySample::nFieldMask holds a bit per field");
+
+CHistoryRing::CHistoryRing()
+{
+    m_pStorage.store(nullptr, std::memory_order_relaxed);
+    m_nCount.store(0, std::memory_order_relaxed);
+    setCapacity(HISTORY_CAPACITY_DEFAULT);
+}
+
+// A reader that loaded the old storage before the swap sees either its samples or, once the
+// count is reset, sequences that don't match and stops. Capacity changes come from the INI at
+// station creation, the few retired arrays aren't worth reclaiming.
+void CHistoryRing::setCapacity(size_t nCapacity)
+{
+    Storage *pStorage = m_pStorage.load(std::memory_order_relaxed);
+    size_t i;
+    int j;
+
+    nCapacity = std::max<size_t>(HISTORY_CAPACITY_MIN, std::min<size_t>(HISTORY_CAPACITY_MAX, nCapacity));
+    if(!pStorage || nCapacity != pStorage->nCapacity) {
+        m_Storages.push_back(std::unique_ptr<Storage>(new Storage));
+        pStorage = m_Storages.back().get();
+        pStorage->nCapacity = nCapacity;
+        pStorage->slots.reset(new Slot[nCapacity]);
+    }
+    for(i = 0; i < pStorage->nCapacity; i++) {
+        pStorage->slots[i].nSequence.store(0, std::memory_order_relaxed);
+        for(j = 0; j < WORDS; j++)
+            pStorage->slots[i].Data[j].store(0, std::memory_order_relaxed);
+    }
+    m_nCount.store(0, std::memory_order_release);
+    m_pStorage.store(pStorage, std::memory_order_release);
+}
+
+int64_t CHistoryRing::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void CHistoryRing::makeSample(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, int64_t nTimeMs, HistorySample &sample)
+{
+    memset(&sample, 0, sizeof(sample));
+    sample.nTimeMs = nTimeMs;
+    sample.dSkyTemp = record.dSkyTemp;
+    sample.dTemp = record.dTemp;
+    sample.dWindSpeed = record.dWindSpeed;
+    sample.dWindGust = record.dWindGust;
+    sample.dDewPointTemp = record.dDewPointTemp;
+    sample.dBarometricPressure = record.dBarometricPressure;
+    sample.nPercentHumdity = int8_t(record.nPercentHumdity);
+    sample.nCloudCondition = int8_t(record.nCloudCondition);
+    sample.nWindCondition = int8_t(record.nWindCondition);
+    sample.nRainCondition = int8_t(record.nRainCondition);
+    sample.nLightCondition = int8_t(record.nLightCondition);
+    sample.nHumdityCondition = int8_t(record.nHumdityCondition);
+    sample.nBarometricPressureCondition = int8_t(record.nBarometricPressureCondition);
+    sample.nOverallConditionSafe = int8_t(record.nOverallConditionSafe);
+    sample.nFieldMask = uint16_t(nFieldMask & FIELD_MASK_ALL);
+}
+
+void CHistoryRing::append(const HistorySample &sample)
+{
+    uint64_t buffer[WORDS];
+    const Storage *pStorage = m_pStorage.load(std::memory_order_relaxed);
+    uint64_t nIndex = m_nCount.load(std::memory_order_relaxed);
+    Slot *pSlot = &pStorage->slots[nIndex % pStorage->nCapacity];
+    int i;
+
+    memcpy(buffer, &sample, sizeof(sample));
+
+    pSlot->nSequence.store(2 * (nIndex + 1) - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(i = 0; i < WORDS; i++)
+        pSlot->Data[i].store(buffer[i], std::memory_order_relaxed);
+    pSlot->nSequence.store(2 * (nIndex + 1), std::memory_order_release);
+
+    m_nCount.store(nIndex + 1, std::memory_order_release);
+}
+
+// false once the writer has wrapped around and reused the slot of sample nIndex
+bool CHistoryRing::readSample(const Storage &storage, uint64_t nIndex, HistorySample &sample)
+{
+    const Slot *pSlot = &storage.slots[nIndex % storage.nCapacity];
+    uint64_t buffer[WORDS];
+    uint64_t nExpected = 2 * (nIndex + 1);
+    uint64_t nSeqBefore;
+    uint64_t nSeqAfter;
+    int nAttempts;
+    int i;
+
+    for(nAttempts = 0; nAttempts < HISTORY_READ_ATTEMPTS; nAttempts++) {
+        nSeqBefore = pSlot->nSequence.load(std::memory_order_acquire);
+        if(nSeqBefore > nExpected)
+            return false;
+        for(i = 0; i < WORDS; i++)
+            buffer[i] = pSlot->Data[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        nSeqAfter = pSlot->nSequence.load(std::memory_order_relaxed);
+        if(nSeqBefore == nExpected && nSeqAfter == nExpected) {
+            memcpy(&sample, buffer, sizeof(sample));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Walks back from the newest sample. Anything the writer overwrites during the walk is older
+// than what was already copied, so the walk just stops there.
+size_t CHistoryRing::getRange(int64_t nFromMs, int64_t nToMs, std::vector<HistorySample> &samples) const
+{
+    const Storage *pStorage = m_pStorage.load(std::memory_order_acquire);
+    HistorySample sample;
+    uint64_t nCount = getCount();
+    uint64_t nOldest = nCount > pStorage->nCapacity ? nCount - pStorage->nCapacity : 0;
+    uint64_t nIndex;
+
+    samples.clear();
+    for(nIndex = nCount; nIndex > nOldest; nIndex--) {
+        if(!readSample(*pStorage, nIndex - 1, sample) || sample.nTimeMs < nFromMs)
+            break;
+        if(sample.nTimeMs <= nToMs)
+            samples.push_back(sample);
+    }
+    std::reverse(samples.begin(), samples.end());
+    return samples.size();
+}
+
+size_t CHistoryRing::getLatest(size_t nSamples, std::vector<HistorySample> &samples) const
+{
+    const Storage *pStorage = m_pStorage.load(std::memory_order_acquire);
+    HistorySample sample;
+    uint64_t nCount = getCount();
+    uint64_t nOldest = nCount > pStorage->nCapacity ? nCount - pStorage->nCapacity : 0;
+    uint64_t nIndex;
+
+    samples.clear();
+    for(nIndex = nCount; nIndex > nOldest && samples.size() < nSamples; nIndex--) {
+        if(!readSample(*pStorage, nIndex - 1, sample))
+            break;
+        samples.push_back(sample);
+    }
+    std::reverse(samples.begin(), samples.end());
+    return samples.size();
+}
+
+// Same walk as getRange without copying the samples out. Readings the poll didn't send, or the
+// device reports as unavailable, are skipped.
+bool CHistoryRing::getStats(int nField, int64_t nFromMs, int64_t nToMs, HistoryStats &stats) const
+{
+    const Storage *pStorage = m_pStorage.load(std::memory_order_acquire);
+    HistorySample sample;
+    uint64_t nCount = getCount();
+    uint64_t nOldest = nCount > pStorage->nCapacity ? nCount - pStorage->nCapacity : 0;
+    uint64_t nIndex;
+    int64_t nRefMs = 0;
+    double dValue;
+    double dX;
+    double dSumX = 0, dSumY = 0, dSumXX = 0, dSumXY = 0;
+    double dDenominator;
+
+    memset(&stats, 0, sizeof(stats));
+    for(nIndex = nCount; nIndex > nOldest; nIndex--) {
+        if(!readSample(*pStorage, nIndex - 1, sample) || sample.nTimeMs < nFromMs)
+            break;
+        if(sample.nTimeMs > nToMs)
+            continue;
+        dValue = fieldValue(sample, nField);
+        if(std::isnan(dValue))
+            continue;
+
+        if(!stats.nSamples) {
+            nRefMs = sample.nTimeMs;
+            stats.dMin = stats.dMax = stats.dLast = dValue;
+        }
+        stats.dMin = std::min(stats.dMin, dValue);
+        stats.dMax = std::max(stats.dMax, dValue);
+        stats.dFirst = dValue;
+        stats.nSamples++;
+
+        // minutes relative to the newest sample keeps the sums well conditioned
+        dX = double(sample.nTimeMs - nRefMs) / 60000.0;
+        dSumX += dX;
+        dSumY += dValue;
+        dSumXX += dX * dX;
+        dSumXY += dX * dValue;
+    }
+    if(!stats.nSamples)
+        return false;
+
+    stats.dMean = dSumY / double(stats.nSamples);
+    dDenominator = double(stats.nSamples) * dSumXX - dSumX * dSumX;
+    if(stats.nSamples > 1 && dDenominator > 0)
+        stats.dSlope = (double(stats.nSamples) * dSumXY - dSumX * dSumY) / dDenominator;
+    return true;
+}
+
+#define SAMPLE_HAS(f)   (sample.nFieldMask & FIELD_BIT(f))
+
+// NAN for readings the poll didn't send or the device flags as unavailable
+double CHistoryRing::fieldValue(const HistorySample &sample, int nField)
+{
+    switch(nField) {
+        case HIST_SKY_TEMP:
+            return SAMPLE_HAS(FIELD_CLOUDS) ? sample.dSkyTemp : NAN;
+        case HIST_TEMP:
+            return SAMPLE_HAS(FIELD_TEMP) ? sample.dTemp : NAN;
+        case HIST_WIND_SPEED:
+            return SAMPLE_HAS(FIELD_WIND) && sample.dWindSpeed > -1 ? sample.dWindSpeed : NAN;
+        case HIST_WIND_GUST:
+            return SAMPLE_HAS(FIELD_GUST) && sample.dWindGust > -1 ? sample.dWindGust : NAN;
+        case HIST_DEW_POINT:
+            return SAMPLE_HAS(FIELD_DEWP) && sample.dDewPointTemp < 100 ? sample.dDewPointTemp : NAN;
+        case HIST_PRESSURE:
+            return SAMPLE_HAS(FIELD_RELPRESS) ? sample.dBarometricPressure : NAN;
+        case HIST_HUMIDITY:
+            return SAMPLE_HAS(FIELD_HUM) && sample.nPercentHumdity > -1 ? double(sample.nPercentHumdity) : NAN;
+        default:
+            return NAN;
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  CHistoryRing
+//
+//  SoloCloudwatcher X2 plugin
+//  Fixed capacity history of recent samples. One writer (the poller) appends, any number of
+//  readers query time ranges without locking or slowing the writer down.
+
+#ifndef __HistoryRing__
+#define __HistoryRing__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "CloudwatcherParser.h"
+
+#define HISTORY_CAPACITY_DEFAULT    4096        // samples, about 5.7 hours at the default 5 s interval
+#define HISTORY_CAPACITY_MIN        16
+#define HISTORY_CAPACITY_MAX        (1 << 20)   // samples, 72 MB
+
+#define HISTORY_READ_ATTEMPTS       3
+
+// the readings worth a trend, 64 bytes. A ring slot adds its 8 byte sequence and isn't cache
+// line aligned, so reading one sample can touch two lines. The conditions are 0 to 3 and the
+// safe flag 0 or 1, 4 bits each leaves room for the field mask.
+struct HistorySample
+{
+    int64_t     nTimeMs;                // system_clock ms since the epoch
+    double      dSkyTemp;
+    double      dTemp;
+    double      dWindSpeed;
+    double      dWindGust;
+    double      dDewPointTemp;
+    double      dBarometricPressure;
+    int8_t      nPercentHumdity;
+    int8_t      nCloudCondition : 4;
+    int8_t      nWindCondition : 4;
+    int8_t      nRainCondition : 4;
+    int8_t      nLightCondition : 4;
+    int8_t      nHumdityCondition : 4;
+    int8_t      nBarometricPressureCondition : 4;
+    int8_t      nOverallConditionSafe : 4;
+    uint16_t    nFieldMask;             // FIELD_BIT() of the readings this poll sent, the others are carried over
+};
+
+enum HistoryField {HIST_SKY_TEMP=0, HIST_TEMP, HIST_WIND_SPEED, HIST_WIND_GUST, HIST_DEW_POINT, HIST_PRESSURE, HIST_HUMIDITY, HIST_FIELD_COUNT};
+
+struct HistoryStats
+{
+    size_t      nSamples;
+    double      dMin;
+    double      dMax;
+    double      dMean;
+    double      dFirst;             // oldest sample in the range
+    double      dLast;              // newest sample in the range
+    double      dSlope;             // least squares trend, units per minute
+};
+
+class CHistoryRing
+{
+public:
+    CHistoryRing();
+
+    // Drops the history, only call while nothing appends. Readers may still be walking the old
+    // slots, so those are kept until the ring is destroyed.
+    void        setCapacity(size_t nCapacity);
+    size_t      getCapacity() const { return m_pStorage.load(std::memory_order_acquire)->nCapacity; }
+    // drops the history and keeps the capacity, same rule as setCapacity
+    void        clear() { setCapacity(getCapacity()); }
+
+    // writer only
+    void        append(const HistorySample &sample);
+
+    uint64_t    getCount() const { return m_nCount.load(std::memory_order_acquire); }
+    // samples with nFromMs <= nTimeMs <= nToMs still in the ring, oldest first
+    size_t      getRange(int64_t nFromMs, int64_t nToMs, std::vector<HistorySample> &samples) const;
+    // the nSamples newest samples, oldest first
+    size_t      getLatest(size_t nSamples, std::vector<HistorySample> &samples) const;
+    // false if no sample in the range has the field
+    bool        getStats(int nField, int64_t nFromMs, int64_t nToMs, HistoryStats &stats) const;
+
+    static void     makeSample(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, int64_t nTimeMs, HistorySample &sample);
+    static double   fieldValue(const HistorySample &sample, int nField);
+    static int64_t  nowMs();
+
+protected:
+    enum { WORDS = (sizeof(HistorySample) + sizeof(uint64_t) - 1) / sizeof(uint64_t) };
+
+    // per slot sequence lock, 2 * (index + 1) once sample index is complete, odd while it's written
+    struct Slot
+    {
+        std::atomic<uint64_t>   nSequence;
+        std::atomic<uint64_t>   Data[WORDS];
+    };
+
+    struct Storage
+    {
+        size_t                  nCapacity;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    static bool readSample(const Storage &storage, uint64_t nIndex, HistorySample &sample);
+
+    std::atomic<Storage *>  m_pStorage;     // current slots, readers load it once per query
+    std::vector<std::unique_ptr<Storage>> m_Storages;   // every allocation, the current one last
+    std::atomic<uint64_t>   m_nCount;       // samples appended so far, the newest is m_nCount - 1
+};
+
+#endif
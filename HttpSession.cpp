@@ -0,0 +1,251 @@
+//
+//  CHttpSession
+//
+//  SoloCloudwatcher X2 plugin
+//  Persistent keep-alive HTTP GET session on a single curl easy handle.
+
+#include "HttpSession.h"
+
+#include <math.h>
+
+CHttpSession::CHttpSession()
+{
+    m_Curl = nullptr;
+    m_nReconnectCount = 0;
+    m_nTruncatedCount = 0;
+    m_bRetrying = false;
+    m_bConnectionUp = false;
+    m_bConnectBudget = false;
+    m_nTimeoutCount = 0;
+    resetTimeout();
+}
+
+CHttpSession::~CHttpSession()
+{
+    close();
+}
+
+// All options are applied once here, curl keeps them for the life of the handle
+// and reuses the same TCP connection for every request as long as the device keeps it open.
+CURLcode CHttpSession::open(const std::string &sUrl)
+{
+    CURLcode res;
+
+    close();
+
+    m_Curl = curl_easy_init();
+    if(!m_Curl)
+        return CURLE_FAILED_INIT;
+
+    m_sUrl.assign(sUrl);
+    m_nReconnectCount = 0;
+    m_nTruncatedCount = 0;
+    m_bRetrying = false;
+    m_bConnectionUp = false;
+    m_nTimeoutCount = 0;
+    resetTimeout();
+
+    res = curl_easy_setopt(m_Curl, CURLOPT_URL, m_sUrl.c_str());
+    if(res != CURLE_OK) {
+        close();
+        return res;
+    }
+
+    curl_easy_setopt(m_Curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(m_Curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(m_Curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(m_Curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(m_Curl, CURLOPT_WRITEFUNCTION, writeFunction);
+    curl_easy_setopt(m_Curl, CURLOPT_WRITEDATA, &m_sResponse);
+    curl_easy_setopt(m_Curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(m_Curl, CURLOPT_CONNECTTIMEOUT, (long)SESSION_CONNECT_TIMEOUT);
+    curl_easy_setopt(m_Curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(m_Curl, CURLOPT_TCP_KEEPIDLE, (long)SESSION_KEEPALIVE_IDLE);
+    curl_easy_setopt(m_Curl, CURLOPT_TCP_KEEPINTVL, (long)SESSION_KEEPALIVE_INTERVAL);
+
+    return CURLE_OK;
+}
+
+void CHttpSession::close()
+{
+    if(m_Curl) {
+        curl_easy_cleanup(m_Curl);
+        m_Curl = nullptr;
+    }
+}
+
+CURL *CHttpSession::beginTransfer()
+{
+    if(!m_Curl)
+        return nullptr;
+
+    m_sResponse.clear(); // keeps the buffer capacity from the previous poll
+    applyTimeout(!m_bConnectionUp);
+    return m_Curl;
+}
+
+// Returns true when the transfer has to be run once more. curl quietly opens a new connection
+// when it finds the kept-alive one closed, a request whose deadline had no room for that and
+// timed out is retried with the connect budget rather than counted against the device.
+bool CHttpSession::endTransfer(CURLcode res)
+{
+    long nConnects = 0;
+    double dConnectSeconds = 0;
+    bool bReconnected;
+
+    curl_easy_getinfo(m_Curl, CURLINFO_NUM_CONNECTS, &nConnects);
+    bReconnected = nConnects > 0 && !m_bConnectBudget;
+    m_bConnectionUp = res == CURLE_OK;
+    if(res == CURLE_OK)
+        trimUnterminated();
+
+    // like Karn's algorithm, a retried transfer doesn't give a usable RTT sample, and the
+    // connect time is left out since the connect budget covers it
+    if(res == CURLE_OK && !m_bRetrying) {
+        curl_easy_getinfo(m_Curl, CURLINFO_CONNECT_TIME, &dConnectSeconds);
+        addRttSample(getRequestTime() - dConnectSeconds * 1000.0);
+    }
+    else if(res == CURLE_OPERATION_TIMEDOUT && !bReconnected) {
+        m_nTimeoutCount.fetch_add(1, std::memory_order_relaxed);
+        // back off, the device may just be slower than the estimate
+        m_dTimeoutMs = fmin(2.0 * m_dTimeoutMs, SESSION_REQUEST_TIMEOUT * 1000.0);
+    }
+
+    if(m_bRetrying) {
+        curl_easy_setopt(m_Curl, CURLOPT_FRESH_CONNECT, 0L);
+        m_bRetrying = false;
+        return false;
+    }
+
+    if(isStaleConnection(res) || (res == CURLE_OPERATION_TIMEDOUT && bReconnected)) {
+        // the device dropped the kept-alive connection, retry once on a fresh one
+        m_nReconnectCount++;
+        m_bRetrying = true;
+        m_sResponse.clear();
+        curl_easy_setopt(m_Curl, CURLOPT_FRESH_CONNECT, 1L);
+        applyTimeout(true);
+        return true;
+    }
+
+    return false;
+}
+
+// curl fails a reply shorter than its Content-Length and a chunked one missing its last chunk,
+// but a reply delimited by the device closing the connection is complete as far as it knows.
+// The Solo ends every line with a newline, so a tail without one was cut off : it's dropped
+// rather than parsed as a shorter value.
+void CHttpSession::trimUnterminated()
+{
+    curl_off_t nContentLength = -1;
+    size_t nLineEnd;
+
+    curl_easy_getinfo(m_Curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &nContentLength);
+    if(nContentLength >= 0 || m_sResponse.empty() || m_sResponse.back() == '\n')
+        return;
+
+    nLineEnd = m_sResponse.rfind('\n');
+    m_sResponse.erase(nLineEnd == std::string::npos ? 0 : nLineEnd + 1);
+    m_nTruncatedCount++;
+}
+
+void CHttpSession::resetTimeout()
+{
+    m_dSmoothedRttMs = 0;
+    m_dRttVarianceMs = 0;
+    m_dTimeoutMs = SESSION_REQUEST_TIMEOUT * 1000.0;
+}
+
+// RFC 6298 : SRTT and RTTVAR smoothed with gains 1/8 and 1/4, timeout = SRTT + max(G, 4 * RTTVAR),
+// clamped to [SESSION_TIMEOUT_MIN, SESSION_REQUEST_TIMEOUT]
+void CHttpSession::addRttSample(double dRttMs)
+{
+    double dSmoothedRtt = m_dSmoothedRttMs;
+    double dTimeout;
+
+    if(dRttMs <= 0)
+        return;
+    if(dSmoothedRtt == 0) {
+        dSmoothedRtt = dRttMs;
+        m_dRttVarianceMs = dRttMs / 2.0;
+    }
+    else {
+        m_dRttVarianceMs = 0.75 * m_dRttVarianceMs + 0.25 * fabs(dSmoothedRtt - dRttMs);
+        dSmoothedRtt = 0.875 * dSmoothedRtt + 0.125 * dRttMs;
+    }
+    m_dSmoothedRttMs = dSmoothedRtt;
+
+    dTimeout = dSmoothedRtt + fmax(double(SESSION_RTT_GRANULARITY), 4.0 * m_dRttVarianceMs);
+    m_dTimeoutMs = fmin(fmax(dTimeout, double(SESSION_TIMEOUT_MIN)), SESSION_REQUEST_TIMEOUT * 1000.0);
+}
+
+// The request gets the RTT derived deadline, plus the connect budget when it's expected to
+// open a new connection. The low speed abort is a separate, shorter window ending a request
+// whose response stops arriving : half the deadline, at least a second. curl only checks the
+// rate once a second, so with a deadline too short to leave that second the deadline alone
+// catches a stall and the window is off.
+void CHttpSession::applyTimeout(bool bConnectBudget)
+{
+    long nTimeoutMs = long(ceil(m_dTimeoutMs));
+    long nLowSpeedTime = long(ceil(nTimeoutMs * SESSION_LOW_SPEED_FRACTION / 1000.0));
+
+    if(nLowSpeedTime < SESSION_LOW_SPEED_MIN)
+        nLowSpeedTime = SESSION_LOW_SPEED_MIN;
+    if((nLowSpeedTime + 1) * 1000L > nTimeoutMs)
+        nLowSpeedTime = 0;
+
+    m_bConnectBudget = bConnectBudget;
+    if(bConnectBudget)
+        nTimeoutMs += SESSION_CONNECT_TIMEOUT * 1000L;
+    curl_easy_setopt(m_Curl, CURLOPT_TIMEOUT_MS, nTimeoutMs);
+    curl_easy_setopt(m_Curl, CURLOPT_LOW_SPEED_LIMIT, nLowSpeedTime ? 1L : 0L);
+    curl_easy_setopt(m_Curl, CURLOPT_LOW_SPEED_TIME, nLowSpeedTime);
+}
+
+bool CHttpSession::isStaleConnection(CURLcode res)
+{
+    switch(res) {
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ms for the last transfer, name lookup and connect included when the connection was new
+double CHttpSession::getRequestTime()
+{
+    double dSeconds = 0;
+
+    if(!m_Curl || curl_easy_getinfo(m_Curl, CURLINFO_TOTAL_TIME, &dSeconds) != CURLE_OK)
+        return 0;
+    return dSeconds * 1000.0;
+}
+
+// ms from the start of the last transfer to the end of each phase, 0 for phases skipped
+// because the connection was reused
+void CHttpSession::getTimings(double &dNameLookup, double &dConnect, double &dFirstByte, double &dTotal)
+{
+    dNameLookup = dConnect = dFirstByte = dTotal = 0;
+    if(!m_Curl)
+        return;
+
+    curl_easy_getinfo(m_Curl, CURLINFO_NAMELOOKUP_TIME, &dNameLookup);
+    curl_easy_getinfo(m_Curl, CURLINFO_CONNECT_TIME, &dConnect);
+    curl_easy_getinfo(m_Curl, CURLINFO_STARTTRANSFER_TIME, &dFirstByte);
+    curl_easy_getinfo(m_Curl, CURLINFO_TOTAL_TIME, &dTotal);
+    dNameLookup *= 1000.0;
+    dConnect *= 1000.0;
+    dFirstByte *= 1000.0;
+    dTotal *= 1000.0;
+}
+
+size_t CHttpSession::writeFunction(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    // returning short fails the transfer with CURLE_WRITE_ERROR instead of buffering a runaway body
+    if(((std::string*)data)->size() + size * nmemb > SESSION_MAX_RESPONSE)
+        return 0;
+    ((std::string*)data)->append((char*)ptr, size * nmemb);
+    return size * nmemb;
+}
@@ -0,0 +1,80 @@
+//
+//  CHttpSession
+//
+//  SoloCloudwatcher X2 plugin
+//  Persistent keep-alive HTTP GET session on a single curl easy handle.
+
+#ifndef __HttpSession__
+#define __HttpSession__
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+
+#ifndef SB_WIN_BUILD
+#include <curl/curl.h>
+#else
+#include "win_includes/curl.h"
+#endif
+
+#define SESSION_CONNECT_TIMEOUT     3   // seconds
+#define SESSION_REQUEST_TIMEOUT     10  // seconds, whole request before the first RTT sample and upper bound after
+#define SESSION_TIMEOUT_MIN         500 // ms, lower bound of the RTT derived request deadline
+#define SESSION_RTT_GRANULARITY     50  // ms, smallest variance term, like TCP's clock granularity G
+#define SESSION_LOW_SPEED_MIN       1   // seconds, shortest stall window, curl checks the rate once a second
+#define SESSION_LOW_SPEED_FRACTION  0.5 // stall window as a fraction of the request deadline
+#define SESSION_KEEPALIVE_IDLE      10  // seconds before the first TCP keep-alive probe
+#define SESSION_KEEPALIVE_INTERVAL  5   // seconds between TCP keep-alive probes
+#define SESSION_MAX_RESPONSE        65536   // bytes, a Solo reply is well under 1KB
+
+class CHttpSession
+{
+public:
+    CHttpSession();
+    ~CHttpSession();
+
+    CURLcode    open(const std::string &sUrl);
+    void        close();
+    bool        isOpen() { return m_Curl != nullptr; }
+
+    // the caller runs the handle on its own multi handle
+    CURL        *beginTransfer();
+    bool        endTransfer(CURLcode res);
+
+    const std::string& response() { return m_sResponse; }
+
+    int         getReconnectCount() { return m_nReconnectCount; }
+    // replies without a Content-Length that ended mid line, the partial line was dropped
+    int         getTruncatedCount() { return m_nTruncatedCount; }
+    uint64_t    getTimeoutCount() { return m_nTimeoutCount.load(std::memory_order_relaxed); }
+    // ms, deadline for the next request and the smoothed RTT it's derived from
+    double      getRequestTimeout() { return m_dTimeoutMs.load(std::memory_order_relaxed); }
+    double      getSmoothedRtt() { return m_dSmoothedRttMs.load(std::memory_order_relaxed); }
+    double      getRequestTime();
+    void        getTimings(double &dNameLookup, double &dConnect, double &dFirstByte, double &dTotal);
+
+protected:
+    CURL        *m_Curl;
+    std::string m_sUrl;
+    std::string m_sResponse;
+    int         m_nReconnectCount;
+    int         m_nTruncatedCount;
+    bool        m_bRetrying;
+    bool        m_bConnectionUp;    // the last request succeeded, curl should reuse its connection
+    bool        m_bConnectBudget;   // the running request's deadline allows for opening a connection
+
+    // RFC 6298 style retransmission timeout, updated by whoever runs the transfers
+    std::atomic<double>     m_dSmoothedRttMs;   // 0 before the first sample
+    double                  m_dRttVarianceMs;
+    std::atomic<double>     m_dTimeoutMs;
+    std::atomic<uint64_t>   m_nTimeoutCount;
+    void        resetTimeout();
+    void        addRttSample(double dRttMs);
+    void        applyTimeout(bool bConnectBudget);
+
+    bool        isStaleConnection(CURLcode res);
+    void        trimUnterminated();
+    static size_t writeFunction(void* ptr, size_t size, size_t nmemb, void* data);
+};
+
+#endif
@@ -0,0 +1,378 @@
+//
+//  CLogger
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide debug log. Callers format into a lock free ring, a writer thread timestamps,
+//  batches and appends the records, and rotates the file by size.
+
+#include "Logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+static const char *s_pszLevelNames[] = {"", "ERROR", "INFO", "DEBUG", "TRACE"};
+static const char *s_pszCategoryNames[] = {"transport", "parse", "poller", "x2"};
+
+std::atomic<int> CLogger::s_nActiveLevels[LOG_CAT_COUNT];
+
+CLogger &CLogger::instance()
+{
+    static CLogger logger;
+    return logger;
+}
+
+CLogger::CLogger()
+{
+    uint64_t i;
+
+    for(i = 0; i < LOG_RING_SIZE; i++)
+        m_Ring[i].nSequence.store(i, std::memory_order_relaxed);
+    m_nTail = 0;
+    m_nHead = 0;
+    m_nDropped = 0;
+
+    m_nUsers = 0;
+    m_nLevel = LOG_LEVEL_DEFAULT;
+    m_nCategories = LOG_CAT_ALL;
+    m_bRunning = false;
+    m_bStopWriter = false;
+
+    m_pFile = nullptr;
+    m_nFileSize = 0;
+    m_nReportedDropped = 0;
+    m_nUnwritten = 0;
+    m_nStampSecond = -1;
+    m_szStamp[0] = 0;
+
+    m_sPath = homeDirectory() + PATH_SEPARATOR LOG_FILE_NAME;
+}
+
+CLogger::~CLogger()
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    stopWriter();
+}
+
+std::string CLogger::homeDirectory()
+{
+    std::string sHome;
+    const char *pszHome;
+
+#if defined(SB_WIN_BUILD)
+    pszHome = getenv("HOMEDRIVE");
+    if(pszHome)
+        sHome = pszHome;
+    pszHome = getenv("HOMEPATH");
+    if(pszHome)
+        sHome += pszHome;
+#else
+    pszHome = getenv("HOME");
+    if(pszHome)
+        sHome = pszHome;
+#endif
+    return sHome;
+}
+
+const char *CLogger::platformName()
+{
+#if defined(SB_WIN_BUILD)
+    return "Windows";
+#elif defined(SB_LINUX_BUILD)
+    return "Linux";
+#elif defined(SB_MAC_BUILD)
+    return "macOS";
+#else
+    return "unknown";
+#endif
+}
+
+void CLogger::open()
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nUsers++;
+    update();
+}
+
+// the last user closing drains the ring and joins the writer, so nothing runs past the plugin's lifetime
+void CLogger::close()
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    if(m_nUsers > 0)
+        m_nUsers--;
+    update();
+}
+
+void CLogger::setLevel(int nLevel)
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    if(nLevel < LOG_OFF)
+        nLevel = LOG_OFF;
+    if(nLevel > LOG_TRACE)
+        nLevel = LOG_TRACE;
+    m_nLevel = nLevel;
+    update();
+}
+
+int CLogger::getLevel()
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nLevel;
+}
+
+void CLogger::setCategories(int nMask)
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nCategories = nMask & LOG_CAT_ALL;
+    update();
+}
+
+int CLogger::getCategories()
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nCategories;
+}
+
+void CLogger::setPath(const std::string &sPath)
+{
+    const std::lock_guard<std::mutex> lock(m_Mutex);
+    if(sPath.empty() || sPath == m_sPath)
+        return;
+    // reopen on the new file if we're already logging
+    stopWriter();
+    m_sPath = sPath;
+    update();
+}
+
+// called with m_Mutex held
+void CLogger::update()
+{
+    bool bWanted = m_nUsers > 0 && m_nLevel > LOG_OFF && m_nCategories != 0;
+
+    if(bWanted && !m_bRunning)
+        startWriter();
+    else if(!bWanted && m_bRunning)
+        stopWriter();
+
+    publishLevels();
+}
+
+// one level per category so the SOLO_LOG test stays a single load and compare
+void CLogger::publishLevels()
+{
+    int i;
+
+    for(i = 0; i < LOG_CAT_COUNT; i++) {
+        if(m_bRunning && (m_nCategories & (1 << i)))
+            s_nActiveLevels[i].store(m_nLevel, std::memory_order_relaxed);
+        else
+            s_nActiveLevels[i].store(LOG_OFF, std::memory_order_relaxed);
+    }
+}
+
+// the previous sessions' log is kept, a file already over the size limit is rotated first
+void CLogger::startWriter()
+{
+    openFile();
+    if(!m_pFile)
+        return;
+    if(m_nFileSize >= LOG_MAX_FILE_SIZE)
+        rotate();
+    m_bStopWriter = false;
+    m_bRunning = true;
+    m_Writer = std::thread(&writerEntry, this);
+}
+
+void CLogger::stopWriter()
+{
+    if(!m_bRunning)
+        return;
+
+    m_bRunning = false;
+    publishLevels();
+    {
+        const std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_bStopWriter = true;
+    }
+    m_Wake.notify_all();
+    // the writer drains what is left before exiting
+    m_Writer.join();
+
+    if(m_pFile)
+        fclose(m_pFile);
+    m_pFile = nullptr;
+}
+
+void CLogger::writerEntry(CLogger *pLogger)
+{
+    pLogger->writerLoop();
+}
+
+// Multiple producers, bounded, never blocks: a producer claims a slot by bumping the tail and
+// publishes it through the slot's sequence number. A full ring drops the record and counts it.
+void CLogger::log(int nCategory, int nLevel, const char *pszFormat, ...)
+{
+    uint64_t nPos = m_nTail.load(std::memory_order_relaxed);
+    Record *pRecord;
+    int64_t nDiff;
+    va_list args;
+
+    for(;;) {
+        pRecord = &m_Ring[nPos & (LOG_RING_SIZE - 1)];
+        nDiff = int64_t(pRecord->nSequence.load(std::memory_order_acquire)) - int64_t(nPos);
+        if(nDiff == 0) {
+            if(m_nTail.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(nDiff < 0) {
+            m_nDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+            nPos = m_nTail.load(std::memory_order_relaxed);
+    }
+
+    pRecord->nTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    pRecord->nCategory = nCategory;
+    pRecord->nLevel = nLevel;
+    va_start(args, pszFormat);
+    vsnprintf(pRecord->szText, sizeof(pRecord->szText), pszFormat, args);
+    va_end(args);
+
+    pRecord->nSequence.store(nPos + 1, std::memory_order_release);
+}
+
+// returns false once the ring is empty
+bool CLogger::drain(std::string &sBatch)
+{
+    Record *pRecord = &m_Ring[m_nHead & (LOG_RING_SIZE - 1)];
+    int nLevel;
+    int nCategory;
+
+    if(pRecord->nSequence.load(std::memory_order_acquire) != m_nHead + 1)
+        return false;
+
+    nLevel = pRecord->nLevel;
+    if(nLevel < LOG_ERROR || nLevel > LOG_TRACE)
+        nLevel = LOG_TRACE;
+    nCategory = pRecord->nCategory;
+    if(nCategory < 0 || nCategory >= LOG_CAT_COUNT)
+        nCategory = LOG_CAT_X2;
+
+    sBatch += '[';
+    appendTimeStamp(sBatch, pRecord->nTimeUs);
+    sBatch += "] [";
+    sBatch += s_pszLevelNames[nLevel];
+    sBatch += "] [";
+    sBatch += s_pszCategoryNames[nCategory];
+    sBatch += "] ";
+    sBatch += pRecord->szText;
+    sBatch += '\n';
+
+    pRecord->nSequence.store(m_nHead + LOG_RING_SIZE, std::memory_order_release);
+    m_nHead++;
+    return true;
+}
+
+// localtime and strftime only run when the second changes
+void CLogger::appendTimeStamp(std::string &sBatch, int64_t nTimeUs)
+{
+    int64_t nSecond = nTimeUs / 1000000;
+    time_t nTime;
+    struct tm tstruct;
+    char szMs[8];
+
+    if(nSecond != m_nStampSecond) {
+        nTime = time_t(nSecond);
+#if defined(SB_WIN_BUILD)
+        localtime_s(&tstruct, &nTime);
+#else
+        localtime_r(&nTime, &tstruct);
+#endif
+        strftime(m_szStamp, sizeof(m_szStamp), "%Y-%m-%d.%X", &tstruct);
+        m_nStampSecond = nSecond;
+    }
+
+    snprintf(szMs, sizeof(szMs), ".%03d", int((nTimeUs / 1000) % 1000));
+    sBatch += m_szStamp;
+    sBatch += szMs;
+}
+
+void CLogger::openFile()
+{
+    long nSize;
+
+    m_pFile = fopen(m_sPath.c_str(), "ab");
+    m_nFileSize = 0;
+    if(!m_pFile)
+        return;
+    fseek(m_pFile, 0, SEEK_END);
+    nSize = ftell(m_pFile);
+    if(nSize > 0)
+        m_nFileSize = size_t(nSize);
+}
+
+void CLogger::rotate()
+{
+    std::string sOldPath = m_sPath + ".1";
+
+    if(m_pFile)
+        fclose(m_pFile);
+    remove(sOldPath.c_str());
+    rename(m_sPath.c_str(), sOldPath.c_str());
+    openFile();
+}
+
+void CLogger::writerLoop()
+{
+    std::string sBatch;
+    uint64_t nDropped;
+    uint64_t nRecords;
+    char szTmp[96];
+    bool bRunning = true;
+
+    while(bRunning) {
+        {
+            std::unique_lock<std::mutex> lock(m_WakeMutex);
+            if(!m_bStopWriter)
+                m_Wake.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_PERIOD));
+            bRunning = !m_bStopWriter;
+        }
+
+        // one write and one flush per batch instead of per line
+        sBatch.clear();
+        nRecords = 0;
+        while(drain(sBatch))
+            nRecords++;
+
+        // a failed rotation left us without a file, retry once per batch and count what is lost meanwhile
+        if(nRecords && !m_pFile)
+            openFile();
+        if(!m_pFile) {
+            m_nUnwritten += nRecords;
+            continue;
+        }
+        if(m_nUnwritten) {
+            snprintf(szTmp, sizeof(szTmp), "[log] %llu records lost, the log file couldn't be opened\n", (unsigned long long)m_nUnwritten);
+            sBatch.insert(0, szTmp);
+            m_nUnwritten = 0;
+        }
+
+        nDropped = m_nDropped.load(std::memory_order_relaxed);
+        if(nDropped != m_nReportedDropped) {
+            snprintf(szTmp, sizeof(szTmp), "[log] %llu records dropped, ring full\n", (unsigned long long)(nDropped - m_nReportedDropped));
+            sBatch += szTmp;
+            m_nReportedDropped = nDropped;
+        }
+
+        if(sBatch.empty())
+            continue;
+
+        fwrite(sBatch.data(), 1, sBatch.size(), m_pFile);
+        fflush(m_pFile);
+        m_nFileSize += sBatch.size();
+        if(m_nFileSize >= LOG_MAX_FILE_SIZE)
+            rotate();
+    }
+}
@@ -0,0 +1,127 @@
+//
+//  CLogger
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide debug log. Callers format into a lock free ring, a writer thread timestamps,
+//  batches and appends the records, and rotates the file by size.
+
+#ifndef __Logger__
+#define __Logger__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define LOG_RING_SIZE       1024        // records, must be a power of 2
+#define LOG_RECORD_TEXT     480         // bytes per record, longer messages are truncated
+#define LOG_WRITER_PERIOD   50          // ms between writer batches
+#define LOG_MAX_FILE_SIZE   (10*1024*1024)  // bytes before the file is rotated to <name>.1
+#define LOG_FILE_NAME       "X2_SoloCloudwatcher.txt"
+
+#if defined(SB_WIN_BUILD)
+#define PATH_SEPARATOR      "\\"
+#else
+#define PATH_SEPARATOR      "/"
+#endif
+
+enum LogLevel {LOG_OFF=0, LOG_ERROR, LOG_INFO, LOG_DEBUG, LOG_TRACE};
+enum LogCategory {LOG_CAT_TRANSPORT=0, LOG_CAT_PARSE, LOG_CAT_POLLER, LOG_CAT_X2, LOG_CAT_COUNT};
+
+#define LOG_CAT_ALL         ((1 << LOG_CAT_COUNT) - 1)  // category mask with every subsystem enabled
+
+// #define PLUGIN_DEBUG 3
+
+// PLUGIN_DEBUG only sets the level the log starts with
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 4
+#define LOG_LEVEL_DEFAULT   LOG_TRACE
+#elif defined PLUGIN_DEBUG
+#define LOG_LEVEL_DEFAULT   LOG_DEBUG
+#else
+#define LOG_LEVEL_DEFAULT   LOG_OFF
+#endif
+
+// a disabled level or category costs one relaxed load and a compare, the arguments aren't evaluated
+#define SOLO_LOG(nCategory, nLevel, ...) do { if(CLogger::isEnabled(nCategory, nLevel)) CLogger::instance().log(nCategory, nLevel, __VA_ARGS__); } while(0)
+
+class CLogger
+{
+public:
+    static CLogger &instance();
+    static bool isEnabled(int nCategory, int nLevel) { return nLevel <= s_nActiveLevels[nCategory].load(std::memory_order_relaxed); }
+
+    // the writer runs while at least one user has the log open, the level isn't LOG_OFF
+    // and at least one category is enabled
+    void        open();
+    void        close();
+    void        setLevel(int nLevel);
+    int         getLevel();
+    void        setCategories(int nMask);   // bit (1 << LogCategory) per enabled subsystem
+    int         getCategories();
+    void        setPath(const std::string &sPath);
+
+    void        log(int nCategory, int nLevel, const char *pszFormat, ...);
+    uint64_t    getDroppedCount() { return m_nDropped.load(std::memory_order_relaxed); }
+
+    static const char *platformName();
+    // where the log and the other per user files go by default
+    static std::string homeDirectory();
+
+protected:
+    struct Record
+    {
+        std::atomic<uint64_t>   nSequence;
+        int64_t                 nTimeUs;    // system_clock
+        int                     nCategory;
+        int                     nLevel;
+        char                    szText[LOG_RECORD_TEXT];
+    };
+
+    CLogger();
+    ~CLogger();
+
+    void        update();
+    void        startWriter();
+    void        stopWriter();
+    void        writerLoop();
+    bool        drain(std::string &sBatch);
+    void        appendTimeStamp(std::string &sBatch, int64_t nTimeUs);
+    void        openFile();
+    void        rotate();
+    static void writerEntry(CLogger *pLogger);
+
+    void        publishLevels();
+
+    static std::atomic<int> s_nActiveLevels[LOG_CAT_COUNT];  // LOG_OFF while the writer isn't running
+
+    Record                  m_Ring[LOG_RING_SIZE];
+    std::atomic<uint64_t>   m_nTail;            // next slot producers claim
+    uint64_t                m_nHead;            // next slot the writer reads
+    std::atomic<uint64_t>   m_nDropped;
+
+    std::mutex              m_Mutex;            // open/close/setLevel/setPath
+    int                     m_nUsers;
+    int                     m_nLevel;
+    int                     m_nCategories;
+    bool                    m_bRunning;
+    std::thread             m_Writer;
+
+    std::mutex              m_WakeMutex;
+    std::condition_variable m_Wake;
+    bool                    m_bStopWriter;      // under m_WakeMutex
+
+    // only changed while the writer is stopped, or by the writer itself
+    std::string             m_sPath;
+    FILE                    *m_pFile;           // null after a failed reopen, the writer retries each batch
+    size_t                  m_nFileSize;
+    uint64_t                m_nReportedDropped;
+    uint64_t                m_nUnwritten;       // records drained while no file was open, reported once one is
+    int64_t                 m_nStampSecond;
+    char                    m_szStamp[32];
+};
+
+#endif
@@ -0,0 +1,470 @@
+//
+//  CMockSolo
+//
+//  SoloCloudwatcher X2 plugin
+//
+
+#include "MockSolo.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <algorithm>
+
+#define MOCK_POLL_WAIT      1000    // ms, upper bound of one event loop wait
+#define MOCK_PATH           "/cgi-bin/cgiLastData"
+
+// a clear evening clouding over, a gust front and the rain sensor tripping, then clearing again
+static const char *s_DefaultReadings[] = {
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-18.62\ntemp=9.41\nwind=6.20\ngust=8.10\nrain=3120\nlightmpsas=20.81\nswitch=0\nsafe=1\nhum=61\nhumSafe=1\ndewp=2.25\nrawir=-9.21\nabspress=955.30\nrelpress=1017.62\npressureSafe=1\ncloudsSafe=1\nwindSafe=1\nrainSafe=1\nlightSafe=1\n",
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-17.95\ntemp=9.33\nwind=7.40\ngust=10.30\nrain=3118\nlightmpsas=20.79\nswitch=0\nsafe=1\nhum=62\nhumSafe=1\ndewp=2.40\nrawir=-8.60\nabspress=955.20\nrelpress=1017.51\npressureSafe=1\ncloudsSafe=1\nwindSafe=1\nrainSafe=1\nlightSafe=1\n",
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-11.20\ntemp=9.10\nwind=11.80\ngust=17.60\nrain=3102\nlightmpsas=20.12\nswitch=0\nsafe=0\nhum=68\nhumSafe=1\ndewp=3.52\nrawir=-2.35\nabspress=954.90\nrelpress=1017.20\npressureSafe=1\ncloudsSafe=0\nwindSafe=1\nrainSafe=1\nlightSafe=1\n",
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-4.85\ntemp=8.72\nwind=24.50\ngust=38.90\nrain=2650\nlightmpsas=18.40\nswitch=1\nsafe=0\nhum=83\nhumSafe=0\ndewp=5.95\nrawir=3.90\nabspress=954.10\nrelpress=1016.35\npressureSafe=1\ncloudsSafe=0\nwindSafe=0\nrainSafe=0\nlightSafe=1\n",
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-9.40\ntemp=8.05\nwind=14.10\ngust=19.80\nrain=2890\nlightmpsas=19.65\nswitch=0\nsafe=0\nhum=79\nhumSafe=1\ndewp=4.60\nrawir=-0.80\nabspress=954.40\nrelpress=1016.68\npressureSafe=1\ncloudsSafe=0\nwindSafe=1\nrainSafe=0\nlightSafe=1\n",
+    "cwinfo=Serial: 2515, FW: 5.89\nclouds=-19.35\ntemp=7.60\nwind=5.30\ngust=7.20\nrain=3125\nlightmpsas=20.95\nswitch=0\nsafe=1\nhum=72\nhumSafe=1\ndewp=2.85\nrawir=-9.95\nabspress=954.80\nrelpress=1017.05\npressureSafe=1\ncloudsSafe=1\nwindSafe=1\nrainSafe=1\nlightSafe=1\n",
+};
+
+CMockSolo::CMockSolo()
+{
+    m_nListenFd = -1;
+    m_nWakeFd[0] = -1;
+    m_nWakeFd[1] = -1;
+    m_nPort = 0;
+    m_nReading = 0;
+    m_nReadingSinceMs = 0;
+    m_nConnections = 0;
+    m_nRequests = 0;
+    m_nReplies = 0;
+    m_nFaults = 0;
+    defaultConfig(m_Config);
+}
+
+CMockSolo::~CMockSolo()
+{
+    stop();
+}
+
+void CMockSolo::defaultConfig(MockSoloConfig &config)
+{
+    size_t i;
+
+    config.sBindAddress.assign("127.0.0.1");
+    config.nPort = MOCK_PORT_DEFAULT;
+    config.readings.clear();
+    for(i = 0; i < sizeof(s_DefaultReadings) / sizeof(s_DefaultReadings[0]); i++)
+        config.readings.push_back(std::string(s_DefaultReadings[i]));
+    config.dAdvancePeriod = 5;
+    config.nLatencyMs = 0;
+    config.nJitterMs = 0;
+    config.nDripMs = 0;
+    config.bCloseDelimited = false;
+    config.nStallPercent = 0;
+    config.nDropPercent = 0;
+    config.nErrorPercent = 0;
+    config.nTruncatePercent = 0;
+    config.nSeed = 1;
+}
+
+int CMockSolo::loadScript(const std::string &sPath, std::vector<std::string> &readings)
+{
+    FILE *pFile;
+    char szLine[1024];
+    std::string sReading;
+    size_t nLen;
+
+    pFile = fopen(sPath.c_str(), "r");
+    if(!pFile)
+        return errno;
+
+    readings.clear();
+    while(fgets(szLine, sizeof(szLine), pFile)) {
+        nLen = strlen(szLine);
+        while(nLen && (szLine[nLen - 1] == '\n' || szLine[nLen - 1] == '\r' || szLine[nLen - 1] == ' '))
+            szLine[--nLen] = 0;
+        if(!nLen || szLine[0] == '#')
+            continue;
+        if(!strcmp(szLine, "---")) {
+            if(!sReading.empty())
+                readings.push_back(sReading);
+            sReading.clear();
+            continue;
+        }
+        sReading.append(szLine, nLen);
+        sReading.push_back('\n');
+    }
+    if(!sReading.empty())
+        readings.push_back(sReading);
+    fclose(pFile);
+
+    return readings.empty() ? EINVAL : 0;
+}
+
+int CMockSolo::start(const MockSoloConfig &config)
+{
+    struct sockaddr_in addr;
+    socklen_t nAddrLen = sizeof(addr);
+    int nOn = 1;
+    int nErr;
+
+    if(m_Thread.joinable())
+        return EBUSY;
+
+    m_Config = config;
+    if(m_Config.readings.empty()) {
+        MockSoloConfig defaults;
+        defaultConfig(defaults);
+        m_Config.readings = defaults.readings;
+    }
+    if(m_Config.sBindAddress.empty())
+        m_Config.sBindAddress.assign("127.0.0.1");
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(m_Config.nPort));
+    if(inet_pton(AF_INET, m_Config.sBindAddress.c_str(), &addr.sin_addr) != 1)
+        return EINVAL;
+
+    m_nListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(m_nListenFd < 0)
+        return errno;
+    setsockopt(m_nListenFd, SOL_SOCKET, SO_REUSEADDR, &nOn, sizeof(nOn));
+    if(bind(m_nListenFd, (struct sockaddr *)&addr, sizeof(addr)) || listen(m_nListenFd, SOMAXCONN)
+       || getsockname(m_nListenFd, (struct sockaddr *)&addr, &nAddrLen) || pipe(m_nWakeFd)) {
+        nErr = errno;
+        close(m_nListenFd);
+        m_nListenFd = -1;
+        return nErr;
+    }
+    m_nPort = ntohs(addr.sin_port);
+
+    m_Random.seed(m_Config.nSeed);
+    m_nReading = 0;
+    m_sBody.clear();
+    m_Thread = std::thread(&CMockSolo::run, this);
+    return 0;
+}
+
+void CMockSolo::stop()
+{
+    size_t i;
+    char cWake = 0;
+
+    if(!m_Thread.joinable())
+        return;
+
+    if(write(m_nWakeFd[1], &cWake, 1) < 0)
+        perror("mock wake");
+    m_Thread.join();
+
+    for(i = 0; i < m_Connections.size(); i++)
+        close(m_Connections[i].nFd);
+    m_Connections.clear();
+    close(m_nListenFd);
+    close(m_nWakeFd[0]);
+    close(m_nWakeFd[1]);
+    m_nListenFd = -1;
+    m_nWakeFd[0] = -1;
+    m_nWakeFd[1] = -1;
+}
+
+void CMockSolo::getStats(MockSoloStats &stats)
+{
+    stats.nConnections = m_nConnections;
+    stats.nRequests = m_nRequests;
+    stats.nReplies = m_nReplies;
+    stats.nFaults = m_nFaults;
+}
+
+// Connections are only ever appended while the poll set built from them is walked, so the
+// first fds.size() - 2 entries still line up with it.
+void CMockSolo::run()
+{
+    std::vector<struct pollfd> fds;
+    struct pollfd fd;
+    int64_t nNowMs;
+    int64_t nWaitMs;
+    size_t nPolled;
+    size_t i;
+    bool bKeep;
+
+    while(true) {
+        nNowMs = nowMs();
+        nWaitMs = MOCK_POLL_WAIT;
+        fds.clear();
+        fd.fd = m_nWakeFd[0];
+        fd.events = POLLIN;
+        fd.revents = 0;
+        fds.push_back(fd);
+        fd.fd = m_nListenFd;
+        fds.push_back(fd);
+        for(i = 0; i < m_Connections.size(); i++) {
+            Connection &connection = m_Connections[i];
+            fd.fd = connection.nFd;
+            fd.events = POLLIN;
+            if(connection.bReplying && !connection.bStalled) {
+                if(connection.nSendAtMs <= nNowMs)
+                    fd.events |= POLLOUT;
+                else
+                    nWaitMs = std::min(nWaitMs, connection.nSendAtMs - nNowMs);
+            }
+            fds.push_back(fd);
+        }
+        nPolled = m_Connections.size();
+
+        if(poll(&fds[0], fds.size(), int(nWaitMs)) < 0 && errno != EINTR)
+            break;
+        if(fds[0].revents)
+            break;
+        if(fds[1].revents & POLLIN)
+            acceptConnections();
+
+        nNowMs = nowMs();
+        for(i = 0; i < nPolled; i++) {
+            Connection &connection = m_Connections[i];
+            bKeep = true;
+            if(fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+                bKeep = readRequest(connection);
+            if(bKeep && connection.bReplying && !connection.bStalled && connection.nSendAtMs <= nNowMs)
+                bKeep = writeReply(connection, nNowMs);
+            if(!bKeep) {
+                close(connection.nFd);
+                connection.nFd = -1;
+            }
+        }
+        m_Connections.erase(std::remove_if(m_Connections.begin(), m_Connections.end(),
+                                           [](const Connection &connection) { return connection.nFd < 0; }),
+                            m_Connections.end());
+    }
+}
+
+void CMockSolo::acceptConnections()
+{
+    Connection connection;
+    int nFd;
+    int nOn = 1;
+
+    while(true) {
+        nFd = accept4(m_nListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(nFd < 0)
+            return;
+        if(m_Connections.size() >= MOCK_MAX_CONNECTIONS) {
+            close(nFd);
+            continue;
+        }
+        setsockopt(nFd, IPPROTO_TCP, TCP_NODELAY, &nOn, sizeof(nOn));
+        connection.nFd = nFd;
+        connection.nOutSent = 0;
+        connection.nBodyStart = 0;
+        connection.nOutLimit = 0;
+        connection.nSendAtMs = 0;
+        connection.bReplying = false;
+        connection.bStalled = false;
+        connection.bCloseAfter = false;
+        m_Connections.push_back(connection);
+        m_nConnections++;
+    }
+}
+
+// Reads what the client sent and starts the reply to a complete request. A request pipelined
+// behind one still being answered waits in sIn. False once the connection has to be closed.
+bool CMockSolo::readRequest(Connection &connection)
+{
+    char szBuf[4096];
+    std::string sHead;
+    std::string sLine;
+    size_t nEnd;
+    ssize_t nRead;
+    bool bKnownPath;
+    bool bClose;
+
+    while(true) {
+        nRead = recv(connection.nFd, szBuf, sizeof(szBuf), 0);
+        if(nRead == 0)
+            return false;
+        if(nRead < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
+        }
+        if(!connection.bStalled)
+            connection.sIn.append(szBuf, size_t(nRead));
+    }
+
+    if(connection.bReplying)
+        return true;
+    nEnd = connection.sIn.find("\r\n\r\n");
+    if(nEnd == std::string::npos)
+        return connection.sIn.size() <= MOCK_MAX_REQUEST;
+
+    sHead = connection.sIn.substr(0, nEnd);
+    connection.sIn.erase(0, nEnd + 4);
+    sLine = sHead.substr(0, sHead.find("\r\n"));
+    std::transform(sHead.begin(), sHead.end(), sHead.begin(), ::tolower);
+
+    bKnownPath = !sLine.compare(0, 4 + strlen(MOCK_PATH), "GET " MOCK_PATH)
+                 && (sLine[4 + strlen(MOCK_PATH)] == ' ' || sLine[4 + strlen(MOCK_PATH)] == '?');
+    bClose = sLine.find("HTTP/1.0") != std::string::npos;
+    if(sHead.find("\r\nconnection: close") != std::string::npos)
+        bClose = true;
+    else if(sHead.find("\r\nconnection: keep-alive") != std::string::npos)
+        bClose = false;
+
+    startReply(connection, bKnownPath, bClose, nowMs());
+    return true;
+}
+
+void CMockSolo::startReply(Connection &connection, bool bKnownPath, bool bClose, int64_t nNowMs)
+{
+    std::string sConnection(bClose ? "Connection: close\r\n" : "");
+    char szHeader[128];
+
+    m_nRequests++;
+    connection.bReplying = true;
+    connection.bStalled = false;
+    connection.bCloseAfter = bClose;
+    connection.nOutSent = 0;
+    connection.nSendAtMs = nNowMs + m_Config.nLatencyMs;
+    if(m_Config.nJitterMs > 0)
+        connection.nSendAtMs += int64_t(m_Random() % unsigned(m_Config.nJitterMs + 1));
+
+    if(!bKnownPath) {
+        connection.sOut = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n" + sConnection + "\r\n";
+        connection.nBodyStart = connection.nOutLimit = connection.sOut.size();
+        return;
+    }
+
+    if(chance(m_Config.nStallPercent)) {
+        connection.bStalled = true;
+        connection.sIn.clear();
+        m_nFaults++;
+        return;
+    }
+    if(chance(m_Config.nDropPercent)) {
+        connection.sOut.clear();
+        connection.nBodyStart = connection.nOutLimit = 0;
+        connection.bCloseAfter = true;
+        m_nFaults++;
+        return;
+    }
+    if(chance(m_Config.nErrorPercent)) {
+        connection.sOut = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n" + sConnection + "\r\n";
+        connection.nBodyStart = connection.nOutLimit = connection.sOut.size();
+        m_nFaults++;
+        return;
+    }
+
+    const std::string &sBody = currentBody(nNowMs);
+    if(m_Config.bCloseDelimited) {
+        // like an HTTP/1.0 server, only the closed connection tells the client the body is complete
+        connection.sOut.assign("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n");
+        connection.bCloseAfter = true;
+    }
+    else {
+        snprintf(szHeader, sizeof(szHeader), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %u\r\n", unsigned(sBody.size()));
+        connection.sOut.assign(szHeader);
+        connection.sOut += sConnection;
+    }
+    connection.sOut += "\r\n";
+    connection.nBodyStart = connection.sOut.size();
+    connection.sOut += sBody;
+    connection.nOutLimit = connection.sOut.size();
+
+    if(chance(m_Config.nTruncatePercent)) {
+        connection.nOutLimit = connection.nBodyStart + sBody.size() / 2;
+        connection.bCloseAfter = true;
+        m_nFaults++;
+    }
+    else
+        m_nReplies++;
+}
+
+// Sends what is due. With a drip period the headers go at once and the body follows
+// MOCK_DRIP_CHUNK bytes at a time. False once the connection has to be closed.
+bool CMockSolo::writeReply(Connection &connection, int64_t nNowMs)
+{
+    size_t nEnd = connection.nOutLimit;
+    ssize_t nSent;
+
+    if(m_Config.nDripMs > 0) {
+        if(connection.nOutSent < connection.nBodyStart)
+            nEnd = std::min(nEnd, connection.nBodyStart);
+        else
+            nEnd = std::min(nEnd, connection.nOutSent + MOCK_DRIP_CHUNK);
+    }
+
+    while(connection.nOutSent < nEnd) {
+        nSent = send(connection.nFd, connection.sOut.data() + connection.nOutSent, nEnd - connection.nOutSent, MSG_NOSIGNAL);
+        if(nSent < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        connection.nOutSent += size_t(nSent);
+    }
+    if(connection.nOutSent < connection.nOutLimit) {
+        connection.nSendAtMs = nNowMs + m_Config.nDripMs;
+        return true;
+    }
+
+    if(connection.bCloseAfter)
+        return false;
+    connection.bReplying = false;
+    connection.sOut.clear();
+    connection.nOutSent = 0;
+    // a request pipelined behind this one
+    if(connection.sIn.find("\r\n\r\n") != std::string::npos)
+        return readRequest(connection);
+    return true;
+}
+
+// The reading in turn, stamped with the wall clock time it became current the way the device
+// stamps its last update.
+const std::string &CMockSolo::currentBody(int64_t nNowMs)
+{
+    int64_t nPeriodMs = int64_t(m_Config.dAdvancePeriod * 1000);
+    int64_t nSteps;
+    char szStamp[64];
+    struct tm utc;
+    time_t nTime;
+
+    if(!m_sBody.empty()) {
+        if(nPeriodMs > 0) {
+            nSteps = (nNowMs - m_nReadingSinceMs) / nPeriodMs;
+            if(!nSteps)
+                return m_sBody;
+            m_nReading = size_t((m_nReading + nSteps) % int64_t(m_Config.readings.size()));
+            m_nReadingSinceMs += nSteps * nPeriodMs;
+        }
+        else {
+            m_nReading = (m_nReading + 1) % m_Config.readings.size();
+            m_nReadingSinceMs = nNowMs;
+        }
+    }
+    else
+        m_nReadingSinceMs = nNowMs;
+
+    nTime = time(NULL);
+    gmtime_r(&nTime, &utc);
+    snprintf(szStamp, sizeof(szStamp), "dataGMTTime=%04d/%02d/%02d %02d:%02d:%02d\n",
+             utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec);
+    m_sBody.assign(szStamp);
+    m_sBody += m_Config.readings[m_nReading];
+    return m_sBody;
+}
+
+bool CMockSolo::chance(int nPercent)
+{
+    return nPercent > 0 && int(m_Random() % 100) < nPercent;
+}
+
+int64_t CMockSolo::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
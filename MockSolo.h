@@ -0,0 +1,109 @@
+//
+//  CMockSolo
+//
+//  SoloCloudwatcher X2 plugin
+//  Stand-in for a Solo Cloudwatcher web server, for tests and load benchmarks without a
+//  device. Serves /cgi-bin/cgiLastData from a scripted sequence of readings, with optional
+//  latency, errors, dropped connections, truncated bodies, stalls and slow-drip replies.
+//  One poll() event loop thread, keep-alive, POSIX only.
+
+#ifndef __MockSolo__
+#define __MockSolo__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <random>
+
+#define MOCK_PORT_DEFAULT       8080
+#define MOCK_MAX_CONNECTIONS    1024
+#define MOCK_MAX_REQUEST        8192    // bytes of request headers before the connection is dropped
+#define MOCK_DRIP_CHUNK         8       // bytes sent per slow-drip step
+
+struct MockSoloConfig
+{
+    std::string sBindAddress;           // default 127.0.0.1
+    int         nPort;                  // 0 picks a free port, see CMockSolo::getPort
+    std::vector<std::string> readings;  // cgiLastData bodies without dataGMTTime, served in turn
+    double      dAdvancePeriod;         // seconds each reading is served, 0 moves on with every request
+    int         nLatencyMs;             // before the reply starts
+    int         nJitterMs;              // uniform, added to nLatencyMs
+    int         nDripMs;                // between MOCK_DRIP_CHUNK byte chunks of the body, 0 sends it at once
+    bool        bCloseDelimited;        // 200 replies carry no Content-Length, closing the connection ends them
+    // percent of requests answered each way, checked in this order
+    int         nStallPercent;          // never answered, the connection stays open
+    int         nDropPercent;           // connection closed without a reply
+    int         nErrorPercent;          // HTTP 500
+    int         nTruncatePercent;       // half the body then closed, under a full Content-Length unless close delimited
+    unsigned int nSeed;                 // for repeatable runs
+};
+
+struct MockSoloStats
+{
+    uint64_t    nConnections;
+    uint64_t    nRequests;
+    uint64_t    nReplies;               // complete 200 replies
+    uint64_t    nFaults;                // stalled, dropped, errored or truncated on purpose
+};
+
+class CMockSolo
+{
+public:
+    CMockSolo();
+    ~CMockSolo();
+
+    static void defaultConfig(MockSoloConfig &config);
+    // readings separated by lines of "---", '#' starts a comment line
+    static int  loadScript(const std::string &sPath, std::vector<std::string> &readings);
+
+    // binds and runs the event loop on its own thread, 0 or an errno value
+    int         start(const MockSoloConfig &config);
+    void        stop();
+    int         getPort() { return m_nPort; }
+    void        getStats(MockSoloStats &stats);
+
+protected:
+    struct Connection
+    {
+        int             nFd;
+        std::string     sIn;
+        std::string     sOut;
+        size_t          nOutSent;
+        size_t          nBodyStart;     // slow drip starts after the headers
+        size_t          nOutLimit;      // bytes of sOut to send before closing, for truncated replies
+        int64_t         nSendAtMs;      // nothing is sent before, latency and drip steps
+        bool            bReplying;
+        bool            bStalled;
+        bool            bCloseAfter;
+    };
+
+    void        run();
+    void        acceptConnections();
+    bool        readRequest(Connection &connection);
+    void        startReply(Connection &connection, bool bKnownPath, bool bClose, int64_t nNowMs);
+    bool        writeReply(Connection &connection, int64_t nNowMs);
+    const std::string &currentBody(int64_t nNowMs);
+    bool        chance(int nPercent);
+    static int64_t  nowMs();
+
+    MockSoloConfig  m_Config;
+    int             m_nListenFd;
+    int             m_nWakeFd[2];
+    int             m_nPort;
+    std::thread     m_Thread;
+    std::vector<Connection> m_Connections;
+    std::minstd_rand m_Random;
+
+    size_t          m_nReading;
+    int64_t         m_nReadingSinceMs;
+    std::string     m_sBody;            // current reading with its dataGMTTime
+
+    std::atomic<uint64_t>   m_nConnections;
+    std::atomic<uint64_t>   m_nRequests;
+    std::atomic<uint64_t>   m_nReplies;
+    std::atomic<uint64_t>   m_nFaults;
+};
+
+#endif
@@ -0,0 +1,115 @@
+//
+//  CMonoClock
+//
+//  SoloCloudwatcher X2 plugin
+//  Monotonic nanosecond time for staleness, scheduling and instrumentation. Everything runs
+//  on steady_clock, short intervals can be timed on the invariant TSC where the CPU has one.
+
+#include "MonoClock.h"
+
+#include <thread>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MONOCLOCK_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
+struct TscCalibration
+{
+    bool    bUsable;
+    double  dMsPerTick;
+};
+
+#ifdef MONOCLOCK_TSC
+// Only an invariant TSC (CPUID 0x80000007 EDX bit 8) ticks at a constant rate through
+// frequency and power state changes and is kept in step across cores.
+static bool hasInvariantTsc()
+{
+    unsigned int nRegs[4] = {0, 0, 0, 0};
+
+#ifdef _MSC_VER
+    int nInfo[4];
+    __cpuid(nInfo, 0x80000000);
+    if((unsigned int)nInfo[0] < 0x80000007)
+        return false;
+    __cpuid(nInfo, 0x80000007);
+    nRegs[3] = (unsigned int)nInfo[3];
+#else
+    if(__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &nRegs[0], &nRegs[1], &nRegs[2], &nRegs[3]);
+#endif
+    return (nRegs[3] & (1u << 8)) != 0;
+}
+#endif
+
+static TscCalibration s_Calibration = {false, 1e-6};
+static std::atomic<bool> s_bFastPath(false);   // set once s_Calibration holds a usable TSC rate
+
+static TscCalibration measure()
+{
+    TscCalibration calibration;
+
+    calibration.bUsable = false;
+    calibration.dMsPerTick = 1e-6;  // steady_clock ns
+#ifdef MONOCLOCK_TSC
+    if(hasInvariantTsc()) {
+        int64_t nStartNs = CMonoClock::nowNs();
+        uint64_t nStartTicks = __rdtsc();
+        int64_t nEndNs;
+        uint64_t nEndTicks;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(MONOCLOCK_CALIBRATION_MS));
+        nEndNs = CMonoClock::nowNs();
+        nEndTicks = __rdtsc();
+        if(nEndTicks > nStartTicks && nEndNs > nStartNs) {
+            calibration.dMsPerTick = double(nEndNs - nStartNs) / 1e6 / double(nEndTicks - nStartTicks);
+            calibration.bUsable = true;
+        }
+    }
+#endif
+    return calibration;
+}
+
+static bool publishCalibration()
+{
+    s_Calibration = measure();
+    s_bFastPath.store(s_Calibration.bUsable, std::memory_order_release);
+    return true;
+}
+
+// the first call measures, C++11 makes that thread safe and the others wait for it
+void CMonoClock::calibrate()
+{
+    static const bool s_bCalibrated = publishCalibration();
+
+    (void)s_bCalibrated;
+}
+
+bool CMonoClock::hasFastPath()
+{
+    return s_bFastPath.load(std::memory_order_acquire);
+}
+
+uint64_t CMonoClock::ticks()
+{
+#ifdef MONOCLOCK_TSC
+    if(s_bFastPath.load(std::memory_order_acquire))
+        return __rdtsc();
+#endif
+    return uint64_t(nowNs());
+}
+
+// a thread moved to a core whose TSC is a little behind reads as zero, not as a huge interval
+double CMonoClock::ticksToMs(uint64_t nStart, uint64_t nEnd)
+{
+    if(nEnd <= nStart)
+        return 0;
+    return double(nEnd - nStart) * (hasFastPath() ? s_Calibration.dMsPerTick : 1e-6);
+}
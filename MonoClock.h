@@ -0,0 +1,57 @@
+//
+//  CMonoClock
+//
+//  SoloCloudwatcher X2 plugin
+//  Monotonic nanosecond time for staleness, scheduling and instrumentation. Everything runs
+//  on steady_clock, short intervals can be timed on the invariant TSC where the CPU has one.
+
+#ifndef __MonoClock__
+#define __MonoClock__
+
+#include <stdint.h>
+#include <chrono>
+
+#define MONOCLOCK_CALIBRATION_MS    5       // TSC against steady_clock, once in calibrate()
+
+class CMonoClock
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // steady_clock since an arbitrary origin, never goes back
+    static int64_t  nowNs() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+    static int64_t  nowMs() { return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count(); }
+
+    // Fast counter for timing short sections on one thread, not a time of day : the invariant
+    // TSC on x86 once calibrated, steady_clock ns before that or without one. Time sections
+    // on the thread that calibrated, so a section never starts on one source and ends on the other.
+    static uint64_t ticks();
+    static double   ticksToMs(uint64_t nStart, uint64_t nEnd);
+    static bool     hasFastPath();
+    // blocks MONOCLOCK_CALIBRATION_MS the first time, call it at thread start up, not on a hot path
+    static void     calibrate();
+};
+
+// Stores the ms elapsed over its scope, or until stop(), in dMs. Meant for a PollTimings
+// phase, which CPollMetrics then adds to its histograms.
+class CScopedTimer
+{
+public:
+    explicit CScopedTimer(double &dMs) : m_dMs(dMs), m_nStart(CMonoClock::ticks()), m_bRunning(true) {}
+    ~CScopedTimer() { stop(); }
+
+    void        stop()
+    {
+        if(m_bRunning) {
+            m_dMs = CMonoClock::ticksToMs(m_nStart, CMonoClock::ticks());
+            m_bRunning = false;
+        }
+    }
+
+protected:
+    double      &m_dMs;
+    uint64_t    m_nStart;
+    bool        m_bRunning;
+};
+
+#endif
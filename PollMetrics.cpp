@@ -0,0 +1,218 @@
+//
+//  CPollMetrics
+//
+//  SoloCloudwatcher X2 plugin
+//  Per station poll counters and log scale latency histograms, exported as Prometheus text.
+
+#include "PollMetrics.h"
+
+#include <stdio.h>
+#include <math.h>
+
+static const char *s_pszPhaseNames[PHASE_COUNT] = {"dns", "connect", "first_byte", "total", "parse", "publish"};
+static const char *s_pszErrorNames[POLL_ERROR_COUNT] = {"transfer", "timeout", "parse"};
+
+struct MetricsFamilyInfo
+{
+    const char  *pszName;
+    const char  *pszType;
+    const char  *pszHelp;
+};
+
+static const MetricsFamilyInfo s_Families[METRICS_FAMILY_COUNT] = {
+    {"solocw_polls_total", "counter", "Polls attempted, failed ones included."},
+    {"solocw_poll_errors_total", "counter", "Failed polls by cause."},
+    {"solocw_unchanged_samples_total", "counter", "Successful polls that returned the same sample as the previous one."},
+    {"solocw_reconnects_total", "counter", "Requests retried on a fresh connection after a stale keep-alive."},
+    {"solocw_missed_deadlines_total", "counter", "Poll deadlines skipped because a poll overran its period."},
+    {"solocw_request_timeout_seconds", "gauge", "Deadline of the next request, from the smoothed round trip time and its variance."},
+    {"solocw_poll_phase_seconds", "histogram", "Successful poll timings by phase, curl phases are measured from the start of the request."},
+    {"solocw_poll_phase_quantile_seconds", "gauge", "p50 and p99 estimated from solocw_poll_phase_seconds."}
+};
+
+CPollMetrics::CPollMetrics()
+{
+    reset();
+}
+
+void CPollMetrics::reset()
+{
+    int i, j;
+
+    for(i = 0; i < PHASE_COUNT; i++) {
+        for(j = 0; j < METRICS_BUCKETS; j++)
+            m_Phases[i].nBuckets[j].store(0, std::memory_order_relaxed);
+        m_Phases[i].nCount.store(0, std::memory_order_relaxed);
+        m_Phases[i].nSumUs.store(0, std::memory_order_relaxed);
+    }
+    m_nPolls.store(0, std::memory_order_relaxed);
+    for(i = 0; i < POLL_ERROR_COUNT; i++)
+        m_nErrors[i].store(0, std::memory_order_relaxed);
+    m_nUnchanged.store(0, std::memory_order_relaxed);
+}
+
+// Only the poller records, readers may see a histogram a sample ahead of its count, which
+// is fine for monitoring and keeps the hot path to a few relaxed increments.
+void CPollMetrics::record(const PollTimings &timings)
+{
+    uint64_t nUs;
+    int i;
+
+    m_nPolls.fetch_add(1, std::memory_order_relaxed);
+    for(i = 0; i < PHASE_COUNT; i++) {
+        nUs = timings.dPhase[i] > 0 ? uint64_t(timings.dPhase[i] * 1000.0) : 0;
+        m_Phases[i].nBuckets[bucketIndex(nUs)].fetch_add(1, std::memory_order_relaxed);
+        m_Phases[i].nCount.fetch_add(1, std::memory_order_relaxed);
+        m_Phases[i].nSumUs.fetch_add(nUs, std::memory_order_relaxed);
+    }
+}
+
+void CPollMetrics::recordError(PollError nError)
+{
+    m_nPolls.fetch_add(1, std::memory_order_relaxed);
+    m_nErrors[nError].fetch_add(1, std::memory_order_relaxed);
+}
+
+int CPollMetrics::bucketIndex(uint64_t nUs)
+{
+    int nIndex = 0;
+
+    while(nIndex < METRICS_BUCKETS - 1 && nUs >= (uint64_t(1) << nIndex))
+        nIndex++;
+    return nIndex;
+}
+
+// interpolates geometrically inside the bucket holding the rank, good to a factor of 2 at worst
+double CPollMetrics::quantile(PollPhase nPhase, double dQuantile)
+{
+    uint64_t nCounts[METRICS_BUCKETS];
+    uint64_t nTotal = 0;
+    uint64_t nSeen = 0;
+    double dRank;
+    double dLow;
+    double dHigh;
+    int i;
+
+    for(i = 0; i < METRICS_BUCKETS; i++) {
+        nCounts[i] = m_Phases[nPhase].nBuckets[i].load(std::memory_order_relaxed);
+        nTotal += nCounts[i];
+    }
+    if(!nTotal)
+        return 0;
+
+    dRank = dQuantile * double(nTotal);
+    for(i = 0; i < METRICS_BUCKETS; i++) {
+        if(!nCounts[i] || double(nSeen + nCounts[i]) < dRank) {
+            nSeen += nCounts[i];
+            continue;
+        }
+        dLow = i ? double(uint64_t(1) << (i - 1)) : 0.5;
+        dHigh = double(uint64_t(1) << i);
+        return dLow * pow(dHigh / dLow, (dRank - double(nSeen)) / double(nCounts[i])) / 1000.0;
+    }
+    return double(uint64_t(1) << (METRICS_BUCKETS - 1)) / 1000.0;
+}
+
+void CPollMetrics::writePrometheusHeader(std::string &sOut, MetricsFamily nFamily)
+{
+    sOut += "# HELP ";
+    sOut += s_Families[nFamily].pszName;
+    sOut += " ";
+    sOut += s_Families[nFamily].pszHelp;
+    sOut += "\n# TYPE ";
+    sOut += s_Families[nFamily].pszName;
+    sOut += " ";
+    sOut += s_Families[nFamily].pszType;
+    sOut += "\n";
+}
+
+void CPollMetrics::writePrometheus(std::string &sOut, MetricsFamily nFamily, const std::string &sStation, uint64_t nReconnects, uint64_t nMissedDeadlines, double dRequestTimeout)
+{
+    std::string sStationLabel;
+    std::string sLabels;
+    uint64_t nCumulative;
+    char szTmp[64];
+    size_t i;
+    int nPhase, j;
+
+    sStationLabel = "station=\"";
+    for(i = 0; i < sStation.size(); i++) {
+        if(sStation[i] == '"' || sStation[i] == '\\')
+            sStationLabel += '\\';
+        sStationLabel += sStation[i];
+    }
+    sStationLabel += "\"";
+
+    switch(nFamily) {
+        case METRICS_POLLS:
+            appendSample(sOut, "solocw_polls_total", sStationLabel, double(getPollCount()));
+            break;
+        case METRICS_ERRORS:
+            for(j = 0; j < POLL_ERROR_COUNT; j++)
+                appendSample(sOut, "solocw_poll_errors_total", sStationLabel + ",cause=\"" + s_pszErrorNames[j] + "\"", double(getErrorCount(PollError(j))));
+            break;
+        case METRICS_UNCHANGED:
+            appendSample(sOut, "solocw_unchanged_samples_total", sStationLabel, double(getUnchangedCount()));
+            break;
+        case METRICS_RECONNECTS:
+            appendSample(sOut, "solocw_reconnects_total", sStationLabel, double(nReconnects));
+            break;
+        case METRICS_MISSED_DEADLINES:
+            appendSample(sOut, "solocw_missed_deadlines_total", sStationLabel, double(nMissedDeadlines));
+            break;
+        case METRICS_REQUEST_TIMEOUT:
+            appendSample(sOut, "solocw_request_timeout_seconds", sStationLabel, dRequestTimeout / 1000.0);
+            break;
+        case METRICS_PHASE:
+            for(nPhase = 0; nPhase < PHASE_COUNT; nPhase++) {
+                Histogram &histogram = m_Phases[nPhase];
+
+                sLabels = sStationLabel + ",phase=\"" + s_pszPhaseNames[nPhase] + "\"";
+                nCumulative = 0;
+                for(j = 0; j < METRICS_BUCKETS - 1; j++) {
+                    nCumulative += histogram.nBuckets[j].load(std::memory_order_relaxed);
+                    formatDouble(szTmp, sizeof(szTmp), double(uint64_t(1) << j) / 1e6);
+                    appendSample(sOut, "solocw_poll_phase_seconds_bucket", sLabels + ",le=\"" + szTmp + "\"", double(nCumulative));
+                }
+                nCumulative += histogram.nBuckets[METRICS_BUCKETS - 1].load(std::memory_order_relaxed);
+                appendSample(sOut, "solocw_poll_phase_seconds_bucket", sLabels + ",le=\"+Inf\"", double(nCumulative));
+                appendSample(sOut, "solocw_poll_phase_seconds_sum", sLabels, double(histogram.nSumUs.load(std::memory_order_relaxed)) / 1e6);
+                appendSample(sOut, "solocw_poll_phase_seconds_count", sLabels, double(nCumulative));
+            }
+            break;
+        case METRICS_PHASE_QUANTILE:
+            for(nPhase = 0; nPhase < PHASE_COUNT; nPhase++) {
+                sLabels = sStationLabel + ",phase=\"" + s_pszPhaseNames[nPhase] + "\"";
+                appendSample(sOut, "solocw_poll_phase_quantile_seconds", sLabels + ",quantile=\"0.5\"", quantile(PollPhase(nPhase), 0.5) / 1000.0);
+                appendSample(sOut, "solocw_poll_phase_quantile_seconds", sLabels + ",quantile=\"0.99\"", quantile(PollPhase(nPhase), 0.99) / 1000.0);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void CPollMetrics::appendSample(std::string &sOut, const char *pszName, const std::string &sLabels, double dValue)
+{
+    char szValue[32];
+
+    formatDouble(szValue, sizeof(szValue), dValue);
+    sOut += pszName;
+    sOut += "{";
+    sOut += sLabels;
+    sOut += "} ";
+    sOut += szValue;
+    sOut += "\n";
+}
+
+// the exposition format wants a '.' whatever numeric locale the host application set
+void CPollMetrics::formatDouble(char *pszBuf, size_t nSize, double dValue)
+{
+    char *p;
+
+    snprintf(pszBuf, nSize, "%.9g", dValue);
+    for(p = pszBuf; *p; p++) {
+        if(*p == ',')
+            *p = '.';
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  CPollMetrics
+//
+//  SoloCloudwatcher X2 plugin
+//  Per station poll counters and log scale latency histograms, exported as Prometheus text.
+
+#ifndef __PollMetrics__
+#define __PollMetrics__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <atomic>
+
+#define METRICS_BUCKETS         26      // bucket i counts durations below 2^i us, the last one everything over ~17 s
+
+// curl's phases are times from the start of the request, parse and publish are durations
+enum PollPhase {PHASE_DNS=0, PHASE_CONNECT, PHASE_FIRST_BYTE, PHASE_TOTAL, PHASE_PARSE, PHASE_PUBLISH, PHASE_COUNT};
+
+enum PollError {POLL_ERROR_TRANSFER=0, POLL_ERROR_TIMEOUT, POLL_ERROR_PARSE, POLL_ERROR_COUNT};
+
+// Prometheus metric families, the exposition format wants all the samples of one family together
+enum MetricsFamily {METRICS_POLLS=0, METRICS_ERRORS, METRICS_UNCHANGED, METRICS_RECONNECTS, METRICS_MISSED_DEADLINES,
+                    METRICS_REQUEST_TIMEOUT, METRICS_PHASE, METRICS_PHASE_QUANTILE, METRICS_FAMILY_COUNT};
+
+struct PollTimings
+{
+    double  dPhase[PHASE_COUNT];    // ms
+};
+
+class CPollMetrics
+{
+public:
+    CPollMetrics();
+
+    void        reset();
+    void        record(const PollTimings &timings);
+    void        recordError(PollError nError);
+    // a successful poll whose body was the same as the previous one, on top of record()
+    void        recordUnchanged() { m_nUnchanged.fetch_add(1, std::memory_order_relaxed); }
+
+    uint64_t    getPollCount() { return m_nPolls.load(std::memory_order_relaxed); }
+    uint64_t    getErrorCount(PollError nError) { return m_nErrors[nError].load(std::memory_order_relaxed); }
+    uint64_t    getUnchangedCount() { return m_nUnchanged.load(std::memory_order_relaxed); }
+    double      quantile(PollPhase nPhase, double dQuantile);   // ms, 0 without samples
+
+    // appends this station's samples of nFamily, dRequestTimeout in ms. Exporters write the family's
+    // HELP/TYPE lines with writePrometheusHeader, then the family's samples of every station.
+    void        writePrometheus(std::string &sOut, MetricsFamily nFamily, const std::string &sStation, uint64_t nReconnects, uint64_t nMissedDeadlines, double dRequestTimeout);
+    static void writePrometheusHeader(std::string &sOut, MetricsFamily nFamily);
+
+protected:
+    struct Histogram
+    {
+        std::atomic<uint64_t>   nBuckets[METRICS_BUCKETS];
+        std::atomic<uint64_t>   nCount;
+        std::atomic<uint64_t>   nSumUs;
+    };
+
+    Histogram               m_Phases[PHASE_COUNT];
+    std::atomic<uint64_t>   m_nPolls;
+    std::atomic<uint64_t>   m_nErrors[POLL_ERROR_COUNT];
+    std::atomic<uint64_t>   m_nUnchanged;
+
+    static int  bucketIndex(uint64_t nUs);
+    static void appendSample(std::string &sOut, const char *pszName, const std::string &sLabels, double dValue);
+    static void formatDouble(char *pszBuf, size_t nSize, double dValue);
+};
+
+#endif
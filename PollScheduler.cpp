@@ -0,0 +1,103 @@
+//
+//  CPollScheduler
+//
+//  SoloCloudwatcher X2 plugin
+//  Drift free poll deadlines on CMonoClock with missed deadline and jitter accounting.
+
+#include "PollScheduler.h"
+
+#include <string.h>
+#include <math.h>
+
+CPollScheduler::CPollScheduler()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_dLatenessM2 = 0;
+    m_nIntervalNs = 0;
+    setInterval(POLL_INTERVAL_DEFAULT);
+    m_NextDeadline = Clock::now();
+    m_PollStart = m_NextDeadline;
+}
+
+void CPollScheduler::setInterval(double dSeconds)
+{
+    if(dSeconds < POLL_INTERVAL_MIN)
+        dSeconds = POLL_INTERVAL_MIN;
+    if(dSeconds > POLL_INTERVAL_MAX)
+        dSeconds = POLL_INTERVAL_MAX;
+
+    m_nIntervalNs = int64_t(dSeconds * 1e9);
+}
+
+double CPollScheduler::getInterval()
+{
+    return double(m_nIntervalNs) / 1e9;
+}
+
+// the first deadline is now, Connect() doesn't wait for the device
+void CPollScheduler::start()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_dLatenessM2 = 0;
+    m_Stats.dInterval = getInterval();
+    m_NextDeadline = Clock::now();
+    m_PublishedStats.store(m_Stats);
+}
+
+// Pushes the next deadline back, for a retry backoff. Polls keep their period from the
+// new deadline and the skipped ones aren't counted as missed.
+void CPollScheduler::defer(Clock::time_point deadline)
+{
+    if(deadline > m_NextDeadline)
+        m_NextDeadline = deadline;
+}
+
+void CPollScheduler::beginPoll()
+{
+    double dLateness;
+    double dDelta;
+
+    m_PollStart = Clock::now();
+    dLateness = std::chrono::duration<double, std::milli>(m_PollStart - m_NextDeadline).count();
+    if(dLateness < 0)
+        dLateness = 0;
+
+    m_Stats.nPolls++;
+    m_Stats.dLastLateness = dLateness;
+    if(dLateness > m_Stats.dMaxLateness)
+        m_Stats.dMaxLateness = dLateness;
+
+    dDelta = dLateness - m_Stats.dMeanLateness;
+    m_Stats.dMeanLateness += dDelta / double(m_Stats.nPolls);
+    m_dLatenessM2 += dDelta * (dLateness - m_Stats.dMeanLateness);
+    m_Stats.dStdDevLateness = m_Stats.nPolls > 1 ? sqrt(m_dLatenessM2 / double(m_Stats.nPolls - 1)) : 0;
+}
+
+// Deadlines advance by whole periods from the previous deadline, not from now, so the
+// request time never accumulates into drift. Deadlines that already passed are skipped
+// and counted instead of being fired back to back.
+void CPollScheduler::endPoll()
+{
+    Clock::time_point now = Clock::now();
+    std::chrono::nanoseconds period(m_nIntervalNs.load());
+    int64_t nBehind;
+
+    m_Stats.dInterval = getInterval();
+    m_Stats.dLastDuration = std::chrono::duration<double, std::milli>(now - m_PollStart).count();
+    if(m_Stats.dLastDuration > m_Stats.dMaxDuration)
+        m_Stats.dMaxDuration = m_Stats.dLastDuration;
+
+    m_NextDeadline += period;
+    if(m_NextDeadline <= now) {
+        nBehind = (now - m_NextDeadline) / period + 1;
+        m_Stats.nMissedDeadlines += nBehind;
+        m_NextDeadline += period * nBehind;
+    }
+
+    m_PublishedStats.store(m_Stats);
+}
+
+void CPollScheduler::getStats(PollSchedulerStats &stats)
+{
+    m_PublishedStats.load(stats);
+}
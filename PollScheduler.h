@@ -0,0 +1,63 @@
+//
+//  CPollScheduler
+//
+//  SoloCloudwatcher X2 plugin
+//  Drift free poll deadlines on CMonoClock with missed deadline and jitter accounting.
+
+#ifndef __PollScheduler__
+#define __PollScheduler__
+
+#include <stdint.h>
+#include <atomic>
+
+#include "SeqLock.h"
+#include "MonoClock.h"
+
+#define POLL_INTERVAL_DEFAULT   5.0     // seconds
+#define POLL_INTERVAL_MIN       0.25    // seconds
+#define POLL_INTERVAL_MAX       300.0   // seconds
+
+struct PollSchedulerStats
+{
+    uint64_t    nPolls;             // polls started
+    uint64_t    nMissedDeadlines;   // deadlines skipped because a poll overran its period
+    double      dInterval;          // seconds, period in use
+    double      dLastLateness;      // ms between a deadline and the poll actually starting
+    double      dMeanLateness;      // ms
+    double      dStdDevLateness;    // ms
+    double      dMaxLateness;       // ms
+    double      dLastDuration;      // ms spent in the last poll
+    double      dMaxDuration;       // ms
+};
+
+class CPollScheduler
+{
+public:
+    typedef CMonoClock::Clock Clock;
+
+    CPollScheduler();
+
+    void        setInterval(double dSeconds);
+    double      getInterval();
+
+    void        start();
+    Clock::time_point nextDeadline() { return m_NextDeadline; }
+    void        beginPoll();
+    void        endPoll();
+    void        defer(Clock::time_point deadline);
+
+    void        getStats(PollSchedulerStats &stats);
+
+protected:
+    std::atomic<int64_t>    m_nIntervalNs;  // can be changed from the UI while the poller runs
+
+    // only touched by the poller thread
+    Clock::time_point       m_NextDeadline;
+    Clock::time_point       m_PollStart;
+    PollSchedulerStats      m_Stats;
+    double                  m_dLatenessM2;  // Welford running sum of squared differences
+
+    CSeqLock<PollSchedulerStats>    m_PublishedStats;
+};
+
+#endif
@@ -0,0 +1,164 @@
+//
+//  CRollingStats
+//
+//  SoloCloudwatcher X2 plugin
+//  Min, max, mean and standard deviation of a few readings over sliding time windows,
+//  updated in O(1) amortized per sample by the poller.
+
+#include "RollingStats.h"
+
+#include <math.h>
+#include <string.h>
+
+static const int64_t s_nWindowLengthMs[ROLLING_WINDOW_COUNT] = {60 * 1000, 5 * 60 * 1000, 15 * 60 * 1000};
+
+CRollingWindow::CRollingWindow()
+{
+    m_nLengthMs = s_nWindowLengthMs[ROLLING_1_MIN];
+    clear();
+}
+
+void CRollingWindow::clear()
+{
+    m_nNextIndex = 0;
+    m_Samples.clear();
+    m_MinQueue.clear();
+    m_MaxQueue.clear();
+    m_dMean = 0;
+    m_dM2 = 0;
+}
+
+void CRollingWindow::add(int64_t nTimeMs, double dValue)
+{
+    Entry entry;
+    double dDelta;
+
+    entry.nIndex = m_nNextIndex++;
+    entry.nTimeMs = nTimeMs;
+    entry.dValue = dValue;
+    m_Samples.push_back(entry);
+
+    // a sample can't be the min (max) while a newer, lower (higher) one is in the window
+    while(!m_MinQueue.empty() && m_MinQueue.back().dValue >= dValue)
+        m_MinQueue.pop_back();
+    m_MinQueue.push_back(entry);
+    while(!m_MaxQueue.empty() && m_MaxQueue.back().dValue <= dValue)
+        m_MaxQueue.pop_back();
+    m_MaxQueue.push_back(entry);
+
+    dDelta = dValue - m_dMean;
+    m_dMean += dDelta / double(m_Samples.size());
+    m_dM2 += dDelta * (dValue - m_dMean);
+}
+
+bool CRollingWindow::expire(int64_t nNowMs)
+{
+    Entry entry;
+    double dDelta;
+    bool bExpired = false;
+
+    while(!m_Samples.empty() && m_Samples.front().nTimeMs <= nNowMs - m_nLengthMs) {
+        bExpired = true;
+        entry = m_Samples.front();
+        m_Samples.pop_front();
+        if(m_MinQueue.front().nIndex == entry.nIndex)
+            m_MinQueue.pop_front();
+        if(m_MaxQueue.front().nIndex == entry.nIndex)
+            m_MaxQueue.pop_front();
+
+        if(m_Samples.empty()) {
+            m_dMean = 0;
+            m_dM2 = 0;
+            continue;
+        }
+        // Welford in reverse
+        dDelta = entry.dValue - m_dMean;
+        m_dMean -= dDelta / double(m_Samples.size());
+        m_dM2 -= dDelta * (entry.dValue - m_dMean);
+        if(m_dM2 < 0)
+            m_dM2 = 0;
+    }
+    return bExpired;
+}
+
+void CRollingWindow::get(RollingValue &value) const
+{
+    memset(&value, 0, sizeof(value));
+    if(m_Samples.empty())
+        return;
+
+    value.nSamples = uint32_t(m_Samples.size());
+    value.dMin = m_MinQueue.front().dValue;
+    value.dMax = m_MaxQueue.front().dValue;
+    value.dMean = m_dMean;
+    if(m_Samples.size() > 1)
+        value.dStdDev = sqrt(m_dM2 / double(m_Samples.size() - 1));
+}
+
+CRollingStats::CRollingStats()
+{
+    int i, j;
+
+    for(i = 0; i < ROLLING_FIELD_COUNT; i++) {
+        for(j = 0; j < ROLLING_WINDOW_COUNT; j++)
+            m_Windows[i][j].setLength(s_nWindowLengthMs[j]);
+    }
+}
+
+void CRollingStats::clear()
+{
+    int i, j;
+
+    for(i = 0; i < ROLLING_FIELD_COUNT; i++) {
+        for(j = 0; j < ROLLING_WINDOW_COUNT; j++)
+            m_Windows[i][j].clear();
+    }
+}
+
+// nTimeMs is on CMonoClock. Readings missing from the poll or reported as unavailable
+// aren't added, but every window still moves forward.
+void CRollingStats::add(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, int64_t nTimeMs)
+{
+    double dValues[ROLLING_FIELD_COUNT];
+    bool bValid[ROLLING_FIELD_COUNT];
+    int i, j;
+
+    dValues[ROLLING_SKY_DELTA] = record.dSkyTemp - record.dTemp;
+    bValid[ROLLING_SKY_DELTA] = (nFieldMask & FIELD_BIT(FIELD_CLOUDS)) && (nFieldMask & FIELD_BIT(FIELD_TEMP));
+    dValues[ROLLING_WIND_SPEED] = record.dWindSpeed;
+    bValid[ROLLING_WIND_SPEED] = (nFieldMask & FIELD_BIT(FIELD_WIND)) && record.dWindSpeed > -1;
+    dValues[ROLLING_WIND_GUST] = record.dWindGust;
+    bValid[ROLLING_WIND_GUST] = (nFieldMask & FIELD_BIT(FIELD_GUST)) && record.dWindGust > -1;
+
+    for(i = 0; i < ROLLING_FIELD_COUNT; i++) {
+        for(j = 0; j < ROLLING_WINDOW_COUNT; j++) {
+            if(bValid[i])
+                m_Windows[i][j].add(nTimeMs, dValues[i]);
+            m_Windows[i][j].expire(nTimeMs);
+        }
+    }
+}
+
+bool CRollingStats::expire(int64_t nNowMs)
+{
+    bool bExpired = false;
+    int i, j;
+
+    for(i = 0; i < ROLLING_FIELD_COUNT; i++) {
+        for(j = 0; j < ROLLING_WINDOW_COUNT; j++) {
+            if(m_Windows[i][j].expire(nNowMs))
+                bExpired = true;
+        }
+    }
+    return bExpired;
+}
+
+void CRollingStats::get(RollingStats &stats) const
+{
+    int i, j;
+
+    for(i = 0; i < ROLLING_FIELD_COUNT; i++) {
+        for(j = 0; j < ROLLING_WINDOW_COUNT; j++)
+            m_Windows[i][j].get(stats.value[i][j]);
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  CRollingStats
+//
+//  SoloCloudwatcher X2 plugin
+//  Min, max, mean and standard deviation of a few readings over sliding time windows,
+//  updated in O(1) amortized per sample by the poller.
+
+#ifndef __RollingStats__
+#define __RollingStats__
+
+#include <stdint.h>
+#include <deque>
+
+#include "CloudwatcherParser.h"
+
+enum RollingField {ROLLING_SKY_DELTA=0, ROLLING_WIND_SPEED, ROLLING_WIND_GUST, ROLLING_FIELD_COUNT};   // sky delta is sky minus ambient
+enum RollingWindow {ROLLING_1_MIN=0, ROLLING_5_MIN, ROLLING_15_MIN, ROLLING_WINDOW_COUNT};
+
+struct RollingValue
+{
+    uint32_t    nSamples;       // 0 when the window holds no valid reading
+    double      dMin;
+    double      dMax;
+    double      dMean;
+    double      dStdDev;
+};
+
+struct RollingStats
+{
+    RollingValue    value[ROLLING_FIELD_COUNT][ROLLING_WINDOW_COUNT];
+};
+
+// one reading over one window
+class CRollingWindow
+{
+public:
+    CRollingWindow();
+
+    void        setLength(int64_t nLengthMs) { m_nLengthMs = nLengthMs; }
+    void        clear();
+    void        add(int64_t nTimeMs, double dValue);
+    // drops the samples older than the window, relative to nNowMs, true if there were any
+    bool        expire(int64_t nNowMs);
+    void        get(RollingValue &value) const;
+
+protected:
+    struct Entry
+    {
+        uint64_t    nIndex;
+        int64_t     nTimeMs;
+        double      dValue;
+    };
+
+    int64_t             m_nLengthMs;
+    uint64_t            m_nNextIndex;
+    std::deque<Entry>   m_Samples;      // every sample in the window, oldest first
+    std::deque<Entry>   m_MinQueue;     // increasing values, the front is the window min
+    std::deque<Entry>   m_MaxQueue;     // decreasing values, the front is the window max
+    double              m_dMean;        // Welford, with removal of the oldest sample
+    double              m_dM2;
+};
+
+// engine thread only, readers get a copy through the published snapshot
+class CRollingStats
+{
+public:
+    CRollingStats();
+
+    void        clear();
+    // only the fields in nFieldMask were read in this poll
+    void        add(const SoloCloudwatcherRecord &record, uint32_t nFieldMask, int64_t nTimeMs);
+    // ages the windows without a new sample, true if the stats changed
+    bool        expire(int64_t nNowMs);
+    void        get(RollingStats &stats) const;
+
+
+protected:
+    CRollingWindow  m_Windows[ROLLING_FIELD_COUNT][ROLLING_WINDOW_COUNT];
+};
+
+#endif
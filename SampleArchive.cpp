@@ -0,0 +1,419 @@
+//
+//  CSampleArchive
+//
+//  SoloCloudwatcher X2 plugin
+//  On disk ring of fixed size sample records, memory mapped and synced once per batch,
+//  so the history survives TheSkyX restarts and can be read by external tools.
+
+#include "SampleArchive.h"
+#include "MonoClock.h"
+#include "DiskWriter.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef SB_WIN_BUILD
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static_assert(sizeof(ArchiveHeader) == ARCHIVE_HEADER_SIZE, "ArchiveHeader is part of the file format");
+static_assert(sizeof(ArchiveRecord) == 80, "ArchiveRecord is part of the file format");
+
+static bool sequenceLess(const ArchiveRecord &a, const ArchiveRecord &b)
+{
+    return a.nSequence < b.nSequence;
+}
+
+CSampleArchive::CSampleArchive()
+{
+    m_pBase = nullptr;
+    m_nSize = 0;
+#ifdef SB_WIN_BUILD
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_hMapping = NULL;
+#else
+    m_nFd = -1;
+#endif
+    m_nCapacity = 0;
+    m_nNextSequence = 1;
+    m_nGeneration = 0;
+    m_nLastFlushMs = 0;
+    m_bSyncQueued = false;
+}
+
+CSampleArchive::~CSampleArchive()
+{
+    close();
+}
+
+// Reuses the file if it holds an archive, even one whose header was torn, otherwise starts
+// a new one. Writing resumes after the newest valid record, whether or not the header made it to disk.
+// A file of any other size is moved aside rather than overwritten.
+int CSampleArchive::open(const std::string &sPath, size_t nCapacity)
+{
+    ArchiveHeader fileHeader;
+    bool bValidHeader = false;
+    long nFileSize = -1;
+    uint64_t nFileCapacity = 0;
+    size_t nSize;
+    std::string sDiscardPath;
+    uint64_t nSlot;
+    uint64_t nNextSequence = 1;
+    uint32_t nGeneration = 0;
+    const ArchiveRecord *pRecord;
+    bool bOtherVersion = false;
+    FILE *pFile;
+
+    close();
+
+    pFile = fopen(sPath.c_str(), "rb");
+    if(pFile) {
+        if(fread(&fileHeader, sizeof(fileHeader), 1, pFile) == 1) {
+            bValidHeader = isValidHeader(fileHeader);
+            bOtherVersion = isOtherVersion(fileHeader);
+        }
+        fseek(pFile, 0, SEEK_END);
+        nFileSize = ftell(pFile);
+        fclose(pFile);
+    }
+    // records of another layout would checksum fine and read as garbage
+    if(!bOtherVersion && nFileSize > ARCHIVE_HEADER_SIZE && (nFileSize - ARCHIVE_HEADER_SIZE) % sizeof(ArchiveRecord) == 0)
+        nFileCapacity = (nFileSize - ARCHIVE_HEADER_SIZE) / sizeof(ArchiveRecord);
+
+    if(bValidHeader && fileHeader.nCapacity == nFileCapacity) {
+        m_nCapacity = nFileCapacity;
+        nNextSequence = std::max<uint64_t>(1, fileHeader.nNextSequence);
+        nGeneration = fileHeader.nGeneration;
+    }
+    else if(nFileCapacity >= ARCHIVE_CAPACITY_MIN && nFileCapacity <= ARCHIVE_CAPACITY_MAX)
+        m_nCapacity = nFileCapacity;
+    else
+        m_nCapacity = std::max<size_t>(ARCHIVE_CAPACITY_MIN, std::min<size_t>(ARCHIVE_CAPACITY_MAX, nCapacity));
+
+    nSize = size_t(ARCHIVE_HEADER_SIZE + m_nCapacity * sizeof(ArchiveRecord));
+    if(nFileSize > 0 && (bOtherVersion || size_t(nFileSize) != nSize)) {
+        sDiscardPath = sPath + ARCHIVE_DISCARD_EXTENSION;
+        if(bOtherVersion)
+            SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[CSampleArchive::open] %s is a version %u archive, moved to %s", sPath.c_str(), fileHeader.nVersion, sDiscardPath.c_str());
+        else
+            SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[CSampleArchive::open] %s is %ld bytes, not an archive, moved to %s", sPath.c_str(), nFileSize, sDiscardPath.c_str());
+        remove(sDiscardPath.c_str());
+        if(rename(sPath.c_str(), sDiscardPath.c_str())) {
+            SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[CSampleArchive::open] can't move %s aside, archive disabled", sPath.c_str());
+            return -1;
+        }
+    }
+
+    // a new file is zero filled, every slot reads as never written
+    if(map(sPath, nSize))
+        return -1;
+
+    for(nSlot = 0; nSlot < m_nCapacity; nSlot++) {
+        pRecord = &records()[nSlot];
+        if(!isValidRecord(*pRecord, nSlot, m_nCapacity))
+            continue;
+        nNextSequence = std::max(nNextSequence, pRecord->nSequence + 1);
+        nGeneration = std::max(nGeneration, pRecord->nGeneration);
+    }
+
+    initHeader(m_nCapacity);
+    m_nNextSequence = nNextSequence;
+    m_nGeneration = nGeneration + 1;
+    header()->nGeneration = m_nGeneration;
+    header()->nNextSequence = m_nNextSequence;
+    sealHeader();
+    m_Pending.reserve(ARCHIVE_BATCH_SIZE);
+    m_nLastFlushMs = CMonoClock::nowMs();
+    return sync();
+}
+
+// the last batch is synced before the mapping goes away
+void CSampleArchive::close()
+{
+    if(!m_pBase)
+        return;
+    flush();
+    CDiskWriter::instance().drain();
+    unmap();
+}
+
+void CSampleArchive::append(const HistorySample &sample)
+{
+    if(!m_pBase)
+        return;
+
+    m_Pending.push_back(sample);
+    if(m_Pending.size() >= ARCHIVE_BATCH_SIZE || CMonoClock::nowMs() - m_nLastFlushMs >= ARCHIVE_FLUSH_PERIOD * 1000)
+        flush();
+}
+
+// One sync per batch, on the disk writer so the engine thread only copies the records into the
+// mapping. A batch written while the previous one is syncing rides on the queued sync. The
+// record checksums are what tell a complete record from a torn one.
+void CSampleArchive::flush()
+{
+    ArchiveRecord *pRecord;
+    size_t i;
+
+    m_nLastFlushMs = CMonoClock::nowMs();
+    if(!m_pBase || m_Pending.empty())
+        return;
+
+    for(i = 0; i < m_Pending.size(); i++) {
+        pRecord = &records()[(m_nNextSequence - 1) % m_nCapacity];
+        pRecord->nSequence = m_nNextSequence;
+        pRecord->nGeneration = m_nGeneration;
+        pRecord->sample = m_Pending[i];
+        pRecord->nChecksum = recordChecksum(*pRecord);
+        m_nNextSequence++;
+    }
+    m_Pending.clear();
+
+    header()->nNextSequence = m_nNextSequence;
+    sealHeader();
+
+    if(m_bSyncQueued.exchange(true))
+        return;
+    CDiskWriter::instance().post([this] {
+        m_bSyncQueued = false;
+        if(sync())
+            SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[CSampleArchive::flush] sync failed");
+    });
+}
+
+size_t CSampleArchive::getLatest(size_t nMax, std::vector<HistorySample> &samples)
+{
+    std::vector<ArchiveRecord> valid;
+    uint64_t nSlot;
+    size_t i;
+
+    samples.clear();
+    if(!m_pBase)
+        return 0;
+
+    for(nSlot = 0; nSlot < m_nCapacity; nSlot++) {
+        if(isValidRecord(records()[nSlot], nSlot, m_nCapacity))
+            valid.push_back(records()[nSlot]);
+    }
+    std::sort(valid.begin(), valid.end(), sequenceLess);
+
+    for(i = valid.size() > nMax ? valid.size() - nMax : 0; i < valid.size(); i++)
+        samples.push_back(valid[i].sample);
+    for(i = 0; i < m_Pending.size(); i++)
+        samples.push_back(m_Pending[i]);
+    if(samples.size() > nMax)
+        samples.erase(samples.begin(), samples.begin() + (samples.size() - nMax));
+    return samples.size();
+}
+
+// plain reads, so a tool can look at an archive a running plugin is writing to
+int CSampleArchive::load(const std::string &sPath, std::vector<ArchiveRecord> &records)
+{
+    ArchiveHeader fileHeader;
+    ArchiveRecord record;
+    uint64_t nCapacity = 0;
+    uint64_t nSlot;
+    long nFileSize;
+    FILE *pFile;
+
+    records.clear();
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    pFile = fopen(sPath.c_str(), "rb");
+    if(!pFile)
+        return -1;
+
+    // a torn header doesn't lose the records, the capacity follows from the file size
+    fseek(pFile, 0, SEEK_END);
+    nFileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    if(fread(&fileHeader, sizeof(fileHeader), 1, pFile) == 1 && isValidHeader(fileHeader))
+        nCapacity = fileHeader.nCapacity;
+    else if(!memcmp(fileHeader.szMagic, ARCHIVE_MAGIC, sizeof(fileHeader.szMagic)) && !isOtherVersion(fileHeader) && nFileSize > ARCHIVE_HEADER_SIZE)
+        nCapacity = (nFileSize - ARCHIVE_HEADER_SIZE) / sizeof(ArchiveRecord);
+    if(!nCapacity) {
+        fclose(pFile);
+        return -1;
+    }
+
+    for(nSlot = 0; nSlot < nCapacity; nSlot++) {
+        if(fread(&record, sizeof(record), 1, pFile) != 1)
+            break;
+        if(isValidRecord(record, nSlot, nCapacity))
+            records.push_back(record);
+    }
+    fclose(pFile);
+
+    std::sort(records.begin(), records.end(), sequenceLess);
+    return 0;
+}
+
+void CSampleArchive::initHeader(size_t nCapacity)
+{
+    ArchiveHeader *pHeader = header();
+
+    memset(pHeader, 0, sizeof(ArchiveHeader));
+    memcpy(pHeader->szMagic, ARCHIVE_MAGIC, sizeof(pHeader->szMagic));
+    pHeader->nVersion = ARCHIVE_VERSION;
+    pHeader->nRecordSize = sizeof(ArchiveRecord);
+    pHeader->nCapacity = nCapacity;
+}
+
+void CSampleArchive::sealHeader()
+{
+    header()->nChecksum = checksum(header(), offsetof(ArchiveHeader, nChecksum));
+}
+
+bool CSampleArchive::isValidHeader(const ArchiveHeader &header)
+{
+    return !memcmp(header.szMagic, ARCHIVE_MAGIC, sizeof(header.szMagic))
+        && header.nVersion == ARCHIVE_VERSION
+        && header.nRecordSize == sizeof(ArchiveRecord)
+        && header.nCapacity >= ARCHIVE_CAPACITY_MIN && header.nCapacity <= ARCHIVE_CAPACITY_MAX
+        && header.nChecksum == checksum(&header, offsetof(ArchiveHeader, nChecksum));
+}
+
+// an intact header of an older or newer layout, as opposed to a torn one
+bool CSampleArchive::isOtherVersion(const ArchiveHeader &header)
+{
+    return !memcmp(header.szMagic, ARCHIVE_MAGIC, sizeof(header.szMagic))
+        && header.nVersion != ARCHIVE_VERSION
+        && header.nChecksum == checksum(&header, offsetof(ArchiveHeader, nChecksum));
+}
+
+bool CSampleArchive::isValidRecord(const ArchiveRecord &record, uint64_t nSlot, uint64_t nCapacity)
+{
+    return record.nSequence && (record.nSequence - 1) % nCapacity == nSlot && record.nChecksum == recordChecksum(record);
+}
+
+// FNV-1a
+uint32_t CSampleArchive::checksum(const void *pData, size_t nLen)
+{
+    const uint8_t *pBytes = (const uint8_t *)pData;
+    uint32_t nHash = 2166136261u;
+    size_t i;
+
+    for(i = 0; i < nLen; i++) {
+        nHash ^= pBytes[i];
+        nHash *= 16777619u;
+    }
+    return nHash;
+}
+
+uint32_t CSampleArchive::recordChecksum(const ArchiveRecord &record)
+{
+    ArchiveRecord copy = record;
+
+    copy.nChecksum = 0;
+    return checksum(&copy, sizeof(copy));
+}
+
+#ifdef SB_WIN_BUILD
+
+int CSampleArchive::map(const std::string &sPath, size_t nSize)
+{
+    ULARGE_INTEGER size;
+    LARGE_INTEGER fileSize;
+
+    m_hFile = CreateFileA(sPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(m_hFile == INVALID_HANDLE_VALUE)
+        return -1;
+
+    // open() moved any other file aside, this one is new or the archive itself
+    size.QuadPart = nSize;
+    if(!GetFileSizeEx(m_hFile, &fileSize) || (fileSize.QuadPart && fileSize.QuadPart != LONGLONG(nSize))) {
+        unmap();
+        return -1;
+    }
+
+    m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+    if(!m_hMapping) {
+        unmap();
+        return -1;
+    }
+    m_pBase = (uint8_t *)MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, nSize);
+    if(!m_pBase) {
+        unmap();
+        return -1;
+    }
+    m_nSize = nSize;
+    return 0;
+}
+
+void CSampleArchive::unmap()
+{
+    if(m_pBase)
+        UnmapViewOfFile(m_pBase);
+    if(m_hMapping)
+        CloseHandle(m_hMapping);
+    if(m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+    m_pBase = nullptr;
+    m_hMapping = NULL;
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_nSize = 0;
+}
+
+int CSampleArchive::sync()
+{
+    if(!FlushViewOfFile(m_pBase, 0) || !FlushFileBuffers(m_hFile))
+        return -1;
+    return 0;
+}
+
+#else
+
+int CSampleArchive::map(const std::string &sPath, size_t nSize)
+{
+    void *pBase;
+    off_t nFileSize;
+
+    m_nFd = ::open(sPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if(m_nFd < 0)
+        return -1;
+
+    // open() moved any other file aside, this one is new or the archive itself
+    nFileSize = lseek(m_nFd, 0, SEEK_END);
+    if(nFileSize < 0 || (nFileSize && nFileSize != off_t(nSize))) {
+        unmap();
+        return -1;
+    }
+    if(!nFileSize && ftruncate(m_nFd, off_t(nSize))) {
+        unmap();
+        return -1;
+    }
+
+    pBase = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, 0);
+    if(pBase == MAP_FAILED) {
+        unmap();
+        return -1;
+    }
+    m_pBase = (uint8_t *)pBase;
+    m_nSize = nSize;
+    return 0;
+}
+
+void CSampleArchive::unmap()
+{
+    if(m_pBase)
+        munmap(m_pBase, m_nSize);
+    if(m_nFd >= 0)
+        ::close(m_nFd);
+    m_pBase = nullptr;
+    m_nFd = -1;
+    m_nSize = 0;
+}
+
+int CSampleArchive::sync()
+{
+    return msync(m_pBase, m_nSize, MS_SYNC) ? -1 : 0;
+}
+
+#endif
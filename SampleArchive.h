@@ -0,0 +1,111 @@
+//
+//  CSampleArchive
+//
+//  SoloCloudwatcher X2 plugin
+//  On disk ring of fixed size sample records, memory mapped and synced once per batch on the
+//  disk writer thread, so the history survives TheSkyX restarts and can be read by external tools.
+//
+//  File layout, little endian :
+//      ArchiveHeader, ARCHIVE_HEADER_SIZE bytes
+//      nCapacity ArchiveRecord slots, record with sequence n (from 1) in slot (n - 1) % nCapacity
+//  A record is only valid if its checksum matches and its sequence belongs to its slot,
+//  which is how a record torn by a crash or power loss is told apart and skipped.
+
+#ifndef __SampleArchive__
+#define __SampleArchive__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "HistoryRing.h"
+
+#define ARCHIVE_MAGIC               "SOLOARC1"
+#define ARCHIVE_VERSION             2           // 2 : HistorySample::nFieldMask
+#define ARCHIVE_HEADER_SIZE         64
+#define ARCHIVE_CAPACITY_DEFAULT    120960      // records, 7 days at the default 5 s interval
+#define ARCHIVE_CAPACITY_MIN        16
+#define ARCHIVE_CAPACITY_MAX        (1 << 24)
+#define ARCHIVE_BATCH_SIZE          12          // records written and synced together
+#define ARCHIVE_FLUSH_PERIOD        60          // seconds, longest a record waits for its batch
+#define ARCHIVE_FILE_EXTENSION      ".arc"
+#define ARCHIVE_DISCARD_EXTENSION   ".bad"      // a file in the way that isn't an archive of a usable size is moved to <name>.bad
+
+struct ArchiveHeader
+{
+    char        szMagic[8];         // ARCHIVE_MAGIC, not null terminated
+    uint32_t    nVersion;
+    uint32_t    nRecordSize;        // sizeof(ArchiveRecord)
+    uint64_t    nCapacity;          // records
+    uint64_t    nNextSequence;      // next sequence after the last synced batch, a hint only
+    uint32_t    nGeneration;        // bumped each time a writer opens the file
+    uint32_t    nChecksum;          // of the bytes above
+    uint8_t     reserved[24];
+};
+
+struct ArchiveRecord
+{
+    uint64_t        nSequence;      // 0 for a slot never written
+    uint32_t        nGeneration;    // writer session that wrote the record
+    uint32_t        nChecksum;      // of nSequence, nGeneration and sample
+    HistorySample   sample;
+};
+
+class CSampleArchive
+{
+public:
+    CSampleArchive();
+    ~CSampleArchive();
+
+    // nCapacity is only used when the file is created, an existing archive keeps its own
+    int         open(const std::string &sPath, size_t nCapacity);
+    void        close();
+    bool        isOpen() { return m_pBase != nullptr; }
+
+    // batched, the records reach the file every ARCHIVE_BATCH_SIZE records or ARCHIVE_FLUSH_PERIOD seconds
+    void        append(const HistorySample &sample);
+    // writes the pending records into the mapping and queues its sync on the disk writer
+    void        flush();
+
+    // valid records of the open archive, oldest first, at most nMax of the newest
+    size_t      getLatest(size_t nMax, std::vector<HistorySample> &samples);
+
+    // for tools : every valid record of an archive file, oldest first
+    static int  load(const std::string &sPath, std::vector<ArchiveRecord> &records);
+
+protected:
+    ArchiveHeader   *header() { return (ArchiveHeader *)m_pBase; }
+    ArchiveRecord   *records() { return (ArchiveRecord *)(m_pBase + ARCHIVE_HEADER_SIZE); }
+
+    int         map(const std::string &sPath, size_t nSize);
+    void        unmap();
+    int         sync();
+    void        initHeader(size_t nCapacity);
+    void        sealHeader();
+
+    static bool     isValidHeader(const ArchiveHeader &header);
+    static bool     isOtherVersion(const ArchiveHeader &header);
+    static bool     isValidRecord(const ArchiveRecord &record, uint64_t nSlot, uint64_t nCapacity);
+    static uint32_t checksum(const void *pData, size_t nLen);
+    static uint32_t recordChecksum(const ArchiveRecord &record);
+
+    uint8_t         *m_pBase;
+    size_t          m_nSize;
+#ifdef SB_WIN_BUILD
+    void            *m_hFile;
+    void            *m_hMapping;
+#else
+    int             m_nFd;
+#endif
+
+    uint64_t        m_nCapacity;
+    uint64_t        m_nNextSequence;
+    uint32_t        m_nGeneration;
+    std::vector<HistorySample>  m_Pending;
+    int64_t         m_nLastFlushMs;     // CMonoClock
+    std::atomic<bool>   m_bSyncQueued;  // a sync is waiting on the disk writer, the next batch rides on it
+};
+
+#endif
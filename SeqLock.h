@@ -0,0 +1,129 @@
+//
+//  CSeqLock
+//
+//  SoloCloudwatcher X2 plugin
+//  Single writer / multiple readers sequence lock for small trivially copyable structs.
+//  The writer never waits. Stores alternate between two slots and readers copy the last
+//  completed one, so a writer preempted in the middle of a store does not hold readers up.
+
+#ifndef __SeqLock__
+#define __SeqLock__
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+class CSeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "CSeqLock needs a trivially copyable type");
+
+public:
+    CSeqLock()
+    {
+        int i, j;
+        m_nCurrent.store(0, std::memory_order_relaxed);
+        for(i = 0; i < 2; i++) {
+            m_Slots[i].nSequence.store(0, std::memory_order_relaxed);
+            m_Slots[i].nVersion.store(0, std::memory_order_relaxed);
+            for(j = 0; j < WORDS; j++)
+                m_Slots[i].Data[j].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // only one thread may call store() or reset() at a time
+    void store(const T &value)
+    {
+        uint32_t nCurrent = m_nCurrent.load(std::memory_order_relaxed);
+
+        publish(value, m_Slots[nCurrent].nVersion.load(std::memory_order_relaxed) + 1);
+    }
+
+    // publishes value as version 0, the way the lock starts out, and counts stores from there again
+    void reset(const T &value)
+    {
+        publish(value, 0);
+    }
+
+    // Bounded read, false only if nAttempts reads in a row raced with the writer
+    // wrapping around to the slot being read. Returns the store count of the copy in nVersion.
+    bool tryLoad(T &value, int nAttempts, uint32_t &nVersion) const
+    {
+        uint64_t buffer[WORDS];
+        uint32_t nSeqBefore;
+        uint32_t nSeqAfter;
+        const Slot *pSlot;
+        int i;
+
+        while(nAttempts-- > 0) {
+            pSlot = &m_Slots[m_nCurrent.load(std::memory_order_acquire)];
+            nSeqBefore = pSlot->nSequence.load(std::memory_order_acquire);
+            for(i = 0; i < WORDS; i++)
+                buffer[i] = pSlot->Data[i].load(std::memory_order_relaxed);
+            nVersion = pSlot->nVersion.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            nSeqAfter = pSlot->nSequence.load(std::memory_order_relaxed);
+            if(!(nSeqBefore & 1) && nSeqBefore == nSeqAfter) {
+                memcpy(&value, buffer, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // returns the number of stores done when the copy was published
+    uint32_t load(T &value) const
+    {
+        uint32_t nVersion = 0;
+
+        while(!tryLoad(value, 1, nVersion))
+            ;
+        return nVersion;
+    }
+
+    uint32_t version() const
+    {
+        return m_Slots[m_nCurrent.load(std::memory_order_acquire)].nVersion.load(std::memory_order_relaxed);
+    }
+
+protected:
+    enum { WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t) };
+
+    void publish(const T &value, uint32_t nVersion)
+    {
+        uint64_t buffer[WORDS];
+        uint32_t nCurrent;
+        uint32_t nSeq;
+        Slot *pSlot;
+        int i;
+
+        buffer[WORDS - 1] = 0;
+        memcpy(buffer, &value, sizeof(T));
+
+        nCurrent = m_nCurrent.load(std::memory_order_relaxed);
+        pSlot = &m_Slots[nCurrent ^ 1];
+
+        nSeq = pSlot->nSequence.load(std::memory_order_relaxed);
+        pSlot->nSequence.store(nSeq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for(i = 0; i < WORDS; i++)
+            pSlot->Data[i].store(buffer[i], std::memory_order_relaxed);
+        pSlot->nVersion.store(nVersion, std::memory_order_relaxed);
+        pSlot->nSequence.store(nSeq + 2, std::memory_order_release);
+
+        m_nCurrent.store(nCurrent ^ 1, std::memory_order_release);
+    }
+
+    struct Slot
+    {
+        std::atomic<uint32_t>   nSequence;
+        std::atomic<uint32_t>   nVersion;
+        std::atomic<uint64_t>   Data[WORDS];
+    };
+
+    std::atomic<uint32_t>   m_nCurrent;
+    Slot                    m_Slots[2];
+};
+
+#endif
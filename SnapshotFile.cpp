@@ -0,0 +1,93 @@
+//
+//  CSnapshotFile
+//
+//  SoloCloudwatcher X2 plugin
+//  Last good reading of a station saved on disk, so a restarted plugin has data to serve
+//  (flagged stale by its age) before the device answers.
+
+#include "SnapshotFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef SB_WIN_BUILD
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// written to a temporary file then renamed, a crash leaves either the old or the new snapshot
+int CSnapshotFile::save(const std::string &sPath, const SoloCloudwatcherRecord &record, int64_t nTimeMs)
+{
+    std::string sTmpPath = sPath + ".tmp";
+    FileContent content;
+    FILE *pFile;
+
+    memset(&content, 0, sizeof(content));
+    memcpy(content.szMagic, SNAPSHOT_MAGIC, sizeof(content.szMagic));
+    content.nVersion = SNAPSHOT_VERSION;
+    content.nRecordSize = sizeof(SoloCloudwatcherRecord);
+    content.nTimeMs = nTimeMs;
+    content.record = record;
+    content.nChecksum = checksum(content);
+
+    pFile = fopen(sTmpPath.c_str(), "wb");
+    if(!pFile)
+        return -1;
+    if(fwrite(&content, sizeof(content), 1, pFile) != 1) {
+        fclose(pFile);
+        remove(sTmpPath.c_str());
+        return -1;
+    }
+    fclose(pFile);
+#ifdef SB_WIN_BUILD
+    // rename doesn't replace an existing file on Windows, and removing it first would leave
+    // no snapshot at all if we stopped in between
+    if(!MoveFileExA(sTmpPath.c_str(), sPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        remove(sTmpPath.c_str());
+        return -1;
+    }
+    return 0;
+#else
+    return rename(sTmpPath.c_str(), sPath.c_str()) ? -1 : 0;
+#endif
+}
+
+int CSnapshotFile::load(const std::string &sPath, SoloCloudwatcherRecord &record, int64_t &nTimeMs)
+{
+    FileContent content;
+    FILE *pFile;
+    bool bValid;
+
+    pFile = fopen(sPath.c_str(), "rb");
+    if(!pFile)
+        return -1;
+    bValid = fread(&content, sizeof(content), 1, pFile) == 1;
+    fclose(pFile);
+
+    bValid = bValid && !memcmp(content.szMagic, SNAPSHOT_MAGIC, sizeof(content.szMagic))
+        && content.nVersion == SNAPSHOT_VERSION
+        && content.nRecordSize == sizeof(SoloCloudwatcherRecord)
+        && content.nChecksum == checksum(content);
+    if(!bValid)
+        return -1;
+
+    record = content.record;
+    record.sFirmware[FIRMWARE_MAX_LEN - 1] = 0;
+    nTimeMs = content.nTimeMs;
+    return 0;
+}
+
+// FNV-1a
+uint32_t CSnapshotFile::checksum(const FileContent &content)
+{
+    const uint8_t *pBytes = (const uint8_t *)&content;
+    uint32_t nHash = 2166136261u;
+    size_t i;
+
+    for(i = 0; i < offsetof(FileContent, nChecksum); i++) {
+        nHash ^= pBytes[i];
+        nHash *= 16777619u;
+    }
+    return nHash;
+}
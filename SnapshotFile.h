@@ -0,0 +1,43 @@
+//
+//  CSnapshotFile
+//
+//  SoloCloudwatcher X2 plugin
+//  Last good reading of a station saved on disk, so a restarted plugin has data to serve
+//  (flagged stale by its age) before the device answers.
+
+#ifndef __SnapshotFile__
+#define __SnapshotFile__
+
+#include <stdint.h>
+#include <string>
+
+#include "CloudwatcherParser.h"
+
+#define SNAPSHOT_MAGIC          "SOLOSNP1"
+#define SNAPSHOT_VERSION        1
+#define SNAPSHOT_SAVE_PERIOD    60          // seconds between saves while polling
+#define SNAPSHOT_MAX_AGE        3600        // seconds, older snapshots aren't restored
+#define SNAPSHOT_FILE_EXTENSION ".snap"
+
+class CSnapshotFile
+{
+public:
+    // nTimeMs is the system_clock time the record was read from the device
+    static int  save(const std::string &sPath, const SoloCloudwatcherRecord &record, int64_t nTimeMs);
+    static int  load(const std::string &sPath, SoloCloudwatcherRecord &record, int64_t &nTimeMs);
+
+protected:
+    struct FileContent
+    {
+        char                    szMagic[8];     // SNAPSHOT_MAGIC, not null terminated
+        uint32_t                nVersion;
+        uint32_t                nRecordSize;    // sizeof(SoloCloudwatcherRecord)
+        int64_t                 nTimeMs;
+        SoloCloudwatcherRecord  record;
+        uint32_t                nChecksum;      // of the bytes above
+    };
+
+    static uint32_t checksum(const FileContent &content);
+};
+
+#endif
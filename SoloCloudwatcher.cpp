@@ -6,248 +6,275 @@
 
 #include "SoloCloudwatcher.h"
 
-void threaded_poller(std::future<void> futureObj, CSoloCloudwatcher *SoloCloudwatcherControllerObj)
-{
-    while (futureObj.wait_for(std::chrono::milliseconds(5000)) == std::future_status::timeout) {
-        if(SoloCloudwatcherControllerObj->m_DevAccessMutex.try_lock()) {
-            SoloCloudwatcherControllerObj->getData();
-            SoloCloudwatcherControllerObj->m_DevAccessMutex.unlock();
-        }
-        else {
-            std::this_thread::yield();
-        }
-    }
-}
-
 CSoloCloudwatcher::CSoloCloudwatcher()
 {
+    AdaptiveLimits limits;
+
     // set some sane values
     m_bIsConnected = false;
-    m_ThreadsAreRunning = false;
+    m_bPolling = false;
     m_sIpAddress.clear();
 
-    m_nCloudCondition = 0;
-    m_dSkyTemp = 0;
-    m_dTemp = 0;
-    m_dWindSpeed = 0;
-    m_nWindCondition = 0;
-    m_dWindGust = 0;
-    m_nRainCondition = 0;
-    m_nLightCondition = 0;
-    m_nPercentHumdity = 0;
-    m_nHumdityCondition = 0;
-    m_dDewPointTemp = 0;
-    m_dBarometricPressure = 0;
-    m_nBarometricPressureCondition = 0;
-    m_nOverallConditionSafe = 0;
-
-
-#ifdef PLUGIN_DEBUG
-#if defined(SB_WIN_BUILD)
-    m_sLogfilePath = getenv("HOMEDRIVE");
-    m_sLogfilePath += getenv("HOMEPATH");
-    m_sLogfilePath += "\\X2_SoloCloudwatcher.txt";
-    m_sPlatform = "Windows";
-#elif defined(SB_LINUX_BUILD)
-    m_sLogfilePath = getenv("HOME");
-    m_sLogfilePath += "/X2_SoloCloudwatcher.txt";
-    m_sPlatform = "Linux";
-#elif defined(SB_MAC_BUILD)
-    m_sLogfilePath = getenv("HOME");
-    m_sLogfilePath += "/X2_SoloCloudwatcher.txt";
-    m_sPlatform = "macOS";
-#endif
-    m_sLogFile.open(m_sLogfilePath, std::ios::out |std::ios::trunc);
-#endif
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [CSoloCloudwatcher] Version " << std::fixed << std::setprecision(2) << PLUGIN_VERSION << " build " << __DATE__ << " " << __TIME__ << " on "<< m_sPlatform << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [CSoloCloudwatcher] Constructor Called." << std::endl;
-    m_sLogFile.flush();
-#endif
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    m_Curl = nullptr;
-
+    memset(&m_Record, 0, sizeof(m_Record));
+    memset(&m_Parsed, 0, sizeof(m_Parsed));
+    memset(m_nFieldTimeMs, 0, sizeof(m_nFieldTimeMs));
+    m_nGoodDataTime = 0;
+
+    m_dPollInterval = POLL_INTERVAL_DEFAULT;
+    m_bAdaptivePolling = false;
+    m_dAdaptiveMinInterval = ADAPTIVE_INTERVAL_MIN_DEFAULT;
+    m_dAdaptiveMaxInterval = ADAPTIVE_INTERVAL_MAX_DEFAULT;
+    CAdaptivePollRate::defaultLimits(limits);
+    m_AdaptiveLimits.store(limits);
+    m_nArchiveCapacity = ARCHIVE_CAPACITY_DEFAULT;
+    m_nPublishedTimeMs = 0;
+    m_nSampleTimeMs = 0;
+    m_nSnapshotSaveMs = 0;
+    m_nBodyFingerprint = 0;
+
+    // the log is shared by all instances, the writer runs while any of them exists
+    CLogger::instance().open();
+    // same for the disk writer that syncs the archive and saves the snapshot
+    CDiskWriter::instance().open();
+    SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[CSoloCloudwatcher] Version %.2f build %s %s on %s", PLUGIN_VERSION, __DATE__, __TIME__, CLogger::platformName());
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[CSoloCloudwatcher] Constructor Called.");
 }
 
 CSoloCloudwatcher::~CSoloCloudwatcher()
 {
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [~CSoloCloudwatcher] Called." << std::endl;
-    m_sLogFile.flush();
-#endif
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[~CSoloCloudwatcher] Called.");
 
     if(m_bIsConnected) {
         Disconnect();
     }
 
-    curl_global_cleanup();
-
-#ifdef    PLUGIN_DEBUG
-    // Close LogFile
-    if(m_sLogFile.is_open())
-        m_sLogFile.close();
-#endif
+    // runs what is still queued, its jobs may log
+    CDiskWriter::instance().close();
+    CLogger::instance().close();
 }
 
 int CSoloCloudwatcher::Connect()
 {
-    int nErr = SB_OK;
+    int nErr = PLUGIN_OK;
     std::string sDummy;
+    WeatherSnapshot snapshot;
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] Called." << std::endl;
-    m_sLogFile.flush();
-#endif
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[Connect] Called.");
 
     if(m_sIpAddress.empty())
-        return ERR_COMMNOLINK;
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] Base url = " << m_sBaseUrl << std::endl;
-    m_sLogFile.flush();
-#endif
+        return CANT_CONNECT;
 
-    m_Curl = curl_easy_init();
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[Connect] Base url = %s", m_sBaseUrl.c_str());
 
-    if(!m_Curl) {
-        m_Curl = nullptr;
-        return ERR_CMDFAILED;
-    }
+    // the session keeps its handle configuration and TCP connection across polls
+    if(m_Session.open(m_sBaseUrl + SOLO_DATA_PATH) != CURLE_OK)
+        return COMMAND_FAILED;
 
+    // nothing from the previous connection carries over : the engine isn't polling us yet, so
+    // the snapshot goes back to the empty version 0 readers take as no data, and the history is
+    // refilled from the archive alone
     m_bIsConnected = true;
-
-    
-    nErr = getData();
-    if (nErr) {
-        curl_easy_cleanup(m_Curl);
-        m_Curl = nullptr;
+    m_nPublishedTimeMs = 0;
+    m_nBodyFingerprint = 0;
+    m_sDataTime.clear();
+    m_ClockOffset.reset();
+    memset(&m_Record, 0, sizeof(m_Record));
+    memset(m_nFieldTimeMs, 0, sizeof(m_nFieldTimeMs));
+    memset(&snapshot, 0, sizeof(snapshot));
+    m_Snapshot.reset(snapshot);
+    m_nGoodDataTime.store(0, std::memory_order_relaxed);
+    m_RollingStats.clear();
+    m_AdaptivePollRate.reset();
+    m_History.clear();
+    openArchive();
+
+    // Connect doesn't wait for the device. A recent enough saved reading is served with its
+    // real age right away, and the engine polls immediately, retrying with backoff until the
+    // device answers.
+    restoreSnapshot();
+    m_ConnectionState.open();
+
+    // from here on polls run on the shared engine thread, on this instance's own schedule
+    m_PollScheduler.start();
+    nErr = CStationEngine::instance().addStation(this);
+    if(nErr) {
+        m_Session.close();
+        m_Archive.close();
+        m_ConnectionState.close();
         m_bIsConnected = false;
-        return ERR_COMMNOLINK;
+        return COMMAND_FAILED;
     }
+    m_bPolling = true;
 
-    
-    if(!m_ThreadsAreRunning) {
-        m_exitSignal = new std::promise<void>();
-        m_futureObj = m_exitSignal->get_future();
-        m_th = std::thread(&threaded_poller, std::move(m_futureObj), this);
-        m_ThreadsAreRunning = true;
-    }
-
-    m_goodDataTimer.Reset();
     return nErr;
 }
 
 
 void CSoloCloudwatcher::Disconnect()
 {
-    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
-
     if(m_bIsConnected) {
-        if(m_ThreadsAreRunning) {
-#ifdef PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Disconnect] Waiting for threads to exit." << std::endl;
-            m_sLogFile.flush();
-#endif
-            m_exitSignal->set_value();
-            m_th.join();
-            delete m_exitSignal;
-            m_exitSignal = nullptr;
-            m_ThreadsAreRunning = false;
+        if(m_bPolling) {
+            SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[Disconnect] Removing station from the poll engine.");
+            // returns once the engine let go of us, an in-flight request is aborted, not waited for
+            CStationEngine::instance().removeStation(this);
+            m_bPolling = false;
         }
 
-        curl_easy_cleanup(m_Curl);
-        m_Curl = nullptr;
+        const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
+        m_Session.close();
+        if(m_nPublishedTimeMs) {
+            WeatherSnapshot snapshot;
+            m_Snapshot.load(snapshot);
+            saveSnapshot(snapshot.record);
+        }
+        // writes out the pending batch
+        m_Archive.close();
+        m_ConnectionState.close();
         m_bIsConnected = false;
 
-#ifdef PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Disconnect] Disconnected." << std::endl;
-        m_sLogFile.flush();
-#endif
+        SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[Disconnect] Disconnected.");
     }
 }
 
 
 void CSoloCloudwatcher::getFirmware(std::string &sFirmware)
 {
-    sFirmware.assign(m_sFirmware);
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    sFirmware.assign(FIRMWARE_PREFIX);
+    sFirmware.append(snapshot.record.sFirmware);
 }
 
+uint32_t CSoloCloudwatcher::getSnapshot(WeatherSnapshot &snapshot)
+{
+    return m_Snapshot.load(snapshot);
+}
 
-int CSoloCloudwatcher::getWindSpeedUnit(int &nUnit)
+// Never blocks and never spins more than SNAPSHOT_READ_ATTEMPTS copies, for the X2 data path.
+// Version 0 is the empty snapshot from before the first poll or restored reading.
+bool CSoloCloudwatcher::peekSnapshot(WeatherSnapshot &snapshot)
 {
-    int nErr = PLUGIN_OK;
-    nUnit = KPH;
-    return nErr;
+    uint32_t nVersion;
+
+    return m_Snapshot.tryLoad(snapshot, SNAPSHOT_READ_ATTEMPTS, nVersion) && nVersion != 0;
 }
 
 
-int CSoloCloudwatcher::doGET(std::string sCmd, std::string &sResp)
+void CSoloCloudwatcher::setPollInterval(double dSeconds)
 {
-    int nErr = PLUGIN_OK;
-    CURLcode res;
-    std::string response_string;
-    std::string header_string;
+    m_dPollInterval = fmin(fmax(dSeconds, POLL_INTERVAL_MIN), POLL_INTERVAL_MAX);
+    if(!m_bAdaptivePolling)
+        m_PollScheduler.setInterval(m_dPollInterval);
 
-    if(!m_bIsConnected)
-        return NOT_CONNECTED;
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] Called." << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] Doing get on " << sCmd << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] Full get url " << (m_sBaseUrl+sCmd) << std::endl;
-    m_sLogFile.flush();
-#endif
-
-    res = curl_easy_setopt(m_Curl, CURLOPT_URL, (m_sBaseUrl+sCmd).c_str());
-    if(res != CURLE_OK) { // if this fails no need to keep going
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] curl_easy_setopt Error = " << res << std::endl;
-        m_sLogFile.flush();
-#endif
-        return ERR_CMDFAILED;
-    }
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[setPollInterval] poll interval : %g s", m_PollScheduler.getInterval());
+}
 
-    curl_easy_setopt(m_Curl, CURLOPT_HTTPGET, 1L);
-    curl_easy_setopt(m_Curl, CURLOPT_POST, 0L);
-    curl_easy_setopt(m_Curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(m_Curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(m_Curl, CURLOPT_WRITEFUNCTION, writeFunction);
-    curl_easy_setopt(m_Curl, CURLOPT_WRITEDATA, &response_string);
-    curl_easy_setopt(m_Curl, CURLOPT_HEADERDATA, &header_string);
-    curl_easy_setopt(m_Curl, CURLOPT_FAILONERROR, 1);
-    curl_easy_setopt(m_Curl, CURLOPT_CONNECTTIMEOUT, 3); // 3 seconds timeout on connect
-
-    // Perform the request, res will get the return code
-    res = curl_easy_perform(m_Curl);
-    // Check for errors
-    if(res != CURLE_OK) {
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] Error = " << res << std::endl;
-        m_sLogFile.flush();
-#endif
-        return ERR_CMDFAILED;
+double CSoloCloudwatcher::getPollInterval()
+{
+    return m_dPollInterval;
+}
+
+// in adaptive mode the interval follows the readings between dMinInterval and dMaxInterval,
+// faster as they get closer to the unsafe boundaries in limits
+void CSoloCloudwatcher::setAdaptivePolling(bool bEnabled, double dMinInterval, double dMaxInterval, const AdaptiveLimits &limits)
+{
+    AdaptiveLimits clamped = limits;
+
+    CAdaptivePollRate::clampLimits(clamped);
+    m_AdaptiveLimits.store(clamped);
+    m_dAdaptiveMinInterval = fmin(fmax(dMinInterval, POLL_INTERVAL_MIN), POLL_INTERVAL_MAX);
+    m_dAdaptiveMaxInterval = fmin(fmax(dMaxInterval, m_dAdaptiveMinInterval.load()), POLL_INTERVAL_MAX);
+    m_bAdaptivePolling = bEnabled;
+    if(!bEnabled)
+        m_PollScheduler.setInterval(m_dPollInterval);
+
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[setAdaptivePolling] enabled : %s min : %g s max : %g s", bEnabled?"Yes":"No", m_dAdaptiveMinInterval.load(), m_dAdaptiveMaxInterval.load());
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[setAdaptivePolling] unsafe sky delta : %g (%g) ºC gust : %g (%g) km/h humidity : %g (%g) %%",
+             clamped.dSkyDeltaUnsafe, clamped.dSkyDeltaMargin, clamped.dGustUnsafe, clamped.dGustMargin, clamped.dHumidityUnsafe, clamped.dHumidityMargin);
+}
+
+void CSoloCloudwatcher::getAdaptivePolling(bool &bEnabled, double &dMinInterval, double &dMaxInterval, AdaptiveLimits &limits)
+{
+    bEnabled = m_bAdaptivePolling;
+    dMinInterval = m_dAdaptiveMinInterval;
+    dMaxInterval = m_dAdaptiveMaxInterval;
+    m_AdaptiveLimits.load(limits);
+}
+
+void CSoloCloudwatcher::getPollSchedulerStats(PollSchedulerStats &stats)
+{
+    m_PollScheduler.getStats(stats);
+}
+
+void CSoloCloudwatcher::appendMetrics(std::string &sOut, MetricsFamily nFamily)
+{
+    PollSchedulerStats stats;
+
+    m_PollScheduler.getStats(stats);
+    m_Metrics.writePrometheus(sOut, nFamily, m_sIpAddress, uint64_t(m_Session.getReconnectCount()), stats.nMissedDeadlines, m_Session.getRequestTimeout());
+}
+
+
+int CSoloCloudwatcher::setHistoryCapacity(size_t nCapacity)
+{
+    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
+
+    if(m_bIsConnected)
+        return COMMAND_FAILED;
+    m_History.setCapacity(nCapacity);
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[setHistoryCapacity] history capacity : %u samples", (unsigned int)m_History.getCapacity());
+    return PLUGIN_OK;
+}
+
+int CSoloCloudwatcher::setArchive(const std::string &sPath, size_t nCapacity)
+{
+    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
+
+    if(m_bIsConnected)
+        return COMMAND_FAILED;
+    m_sArchivePath = sPath;
+    m_nArchiveCapacity = nCapacity;
+    return PLUGIN_OK;
+}
+
+// The history picks up where the archive left off. A station that can't open its archive
+// still polls, it just doesn't keep anything on disk.
+void CSoloCloudwatcher::openArchive()
+{
+    std::vector<HistorySample> samples;
+    size_t i;
+
+    if(m_sArchivePath.empty() || !m_nArchiveCapacity)
+        return;
+
+    if(m_Archive.open(m_sArchivePath, m_nArchiveCapacity)) {
+        SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[openArchive] can't open %s", m_sArchivePath.c_str());
+        m_Archive.close();
+        return;
     }
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] response = " << response_string << std::endl;
-    m_sLogFile.flush();
-#endif
+    m_Archive.getLatest(m_History.getCapacity(), samples);
+    for(i = 0; i < samples.size(); i++)
+        m_History.append(samples[i]);
+    SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[openArchive] %s, %u samples restored", m_sArchivePath.c_str(), (unsigned int)samples.size());
+}
 
-    sResp.assign(response_string);
+int CSoloCloudwatcher::setSnapshotFile(const std::string &sPath)
+{
+    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [doGET] sResp = " << sResp << std::endl;
-    m_sLogFile.flush();
-#endif
-    return nErr;
+    if(m_bIsConnected)
+        return COMMAND_FAILED;
+    m_sSnapshotPath = sPath;
+    return PLUGIN_OK;
 }
 
-size_t CSoloCloudwatcher::writeFunction(void* ptr, size_t size, size_t nmemb, void* data)
+int CSoloCloudwatcher::getWindSpeedUnit(int &nUnit)
 {
-    ((std::string*)data)->append((char*)ptr, size * nmemb);
-    return size * nmemb;
+    int nErr = PLUGIN_OK;
+    nUnit = KPH;
+    return nErr;
 }
 
 
@@ -255,184 +282,408 @@ size_t CSoloCloudwatcher::writeFunction(void* ptr, size_t size, size_t nmemb, vo
 
 int     CSoloCloudwatcher::getCloudCondition()
 {
-    return m_nCloudCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nCloudCondition;
 }
 
 double  CSoloCloudwatcher::getSkyTemp()
 {
-    return m_dSkyTemp;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dSkyTemp;
 }
 
 double  CSoloCloudwatcher::getAmbianTemp()
 {
-    return m_dTemp;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dTemp;
 }
 
 double  CSoloCloudwatcher::getWindSpeed()
 {
-    return m_dWindSpeed;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dWindSpeed;
 }
 
 int     CSoloCloudwatcher::getWindCondition()
 {
-    return m_nWindCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nWindCondition;
 }
 
 double  CSoloCloudwatcher::getWindGust()
 {
-    return m_dWindGust;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dWindGust;
 }
 
 int     CSoloCloudwatcher::getRainCondition()
 {
-    return m_nRainCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nRainCondition;
 }
 
 int     CSoloCloudwatcher::getLightCondition()
 {
-    return m_nLightCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nLightCondition;
 }
 
 int  CSoloCloudwatcher::getHumidity()
 {
-    return m_nPercentHumdity;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nPercentHumdity;
 }
 
 int     CSoloCloudwatcher::getHumdityCondition()
 {
-    return m_nHumdityCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nHumdityCondition;
 }
 
 double  CSoloCloudwatcher::getDewPointTemp()
 {
-    return m_dDewPointTemp;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dDewPointTemp;
 }
 
 double  CSoloCloudwatcher::getBarometricPressure()
 {
-    return m_dBarometricPressure;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.dBarometricPressure;
 }
 
 int     CSoloCloudwatcher::getBarometricPressureCondition()
 {
-    return m_nBarometricPressureCondition;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nBarometricPressureCondition;
 }
 
 int CSoloCloudwatcher::getSafeCondition()
 {
-    return m_nOverallConditionSafe;
+    WeatherSnapshot snapshot;
+
+    m_Snapshot.load(snapshot);
+    return snapshot.record.nOverallConditionSafe;
 }
 
 double CSoloCloudwatcher::getSecondOfGoodData()
 {
-    return m_goodDataTimer.GetElapsedSeconds();
+    int64_t nNow = CMonoClock::nowNs();
+    int64_t nGoodDataTime = m_nGoodDataTime.load(std::memory_order_relaxed);
+
+    if(!nGoodDataTime)
+        return -1;
+    return double(nNow - nGoodDataTime) / 1e9;
 }
 
-int CSoloCloudwatcher::getData()
+bool CSoloCloudwatcher::isFieldCurrent(const WeatherSnapshot &snapshot, int nField)
 {
-    int nErr = PLUGIN_OK;
-    std::map<std::string, std::string> dictResp;
-    std::string response_string;
-    std::string SoloCloudwatcherError;
+    int64_t nNewestMs;
+    int i;
 
-    if(!m_bIsConnected || !m_Curl)
-        return ERR_COMMNOLINK;
+    if(nField < 0 || nField >= FIELD_COUNT || !snapshot.nFieldTimeMs[nField])
+        return false;
+    nNewestMs = snapshot.nFieldTimeMs[nField];
+    for(i = 0; i < FIELD_COUNT; i++) {
+        if(snapshot.nFieldTimeMs[i] > nNewestMs)
+            nNewestMs = snapshot.nFieldTimeMs[i];
+    }
+    return nNewestMs - snapshot.nFieldTimeMs[nField] <= FIELD_MAX_AGE * 1000;
+}
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] Called." << std::endl;
-    m_sLogFile.flush();
-#endif
+// from m_nFieldTimeMs, so a poll that misses a safety field doesn't make the reading look fresh
+void CSoloCloudwatcher::updateGoodDataTime()
+{
+    int64_t nOldestMs = 0;
+    int i;
 
-    // do http GET request to PLC got get current Az or Ticks .. TBD
-    nErr = doGET("/cgi-bin/cgiLastData", response_string);
-    if(nErr) {
-        m_goodDataTimer.Reset();
-        return ERR_CMDFAILED;
+    for(i = 0; i < FIELD_COUNT; i++) {
+        if(!(FIELD_MASK_SAFETY & FIELD_BIT(i)))
+            continue;
+        if(!m_nFieldTimeMs[i]) {
+            nOldestMs = 0;
+            break;
+        }
+        if(!nOldestMs || m_nFieldTimeMs[i] < nOldestMs)
+            nOldestMs = m_nFieldTimeMs[i];
     }
+    m_nGoodDataTime.store(nOldestMs * 1000000, std::memory_order_relaxed);
+}
+
+CMonoClock::Clock::time_point CSoloCloudwatcher::nextPollDeadline()
+{
+    return m_PollScheduler.nextDeadline();
+}
+
+CURL *CSoloCloudwatcher::startPoll()
+{
+    m_PollScheduler.beginPoll();
+    return m_Session.beginTransfer();
+}
+
+bool CSoloCloudwatcher::finishPoll(CURLcode res)
+{
+    // a stale keep-alive connection gets one retry on a fresh one before this counts as a failure
+    if(m_Session.endTransfer(res))
+        return true;
 
-    // process response_string
-    try {
-        // call a parse function
-        nErr = parseFields(response_string, dictResp, '=');
-        if(!nErr){
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] cwinfo         : " << dictResp["cwinfo"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] cloudsSafe     : " << dictResp["cloudsSafe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] clouds         : " << dictResp["clouds"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] temp           : " << dictResp["temp"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] wind           : " << dictResp["wind"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] windSafe       : " << dictResp["windSafe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] gust           : " << dictResp["gust"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] rainSafe       : " << dictResp["rainSafe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] lightSafe      : " << dictResp["lightSafe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] safe           : " << dictResp["safe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] hum            : " << dictResp["hum"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] humSafe        : " << dictResp["humSafe"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] dewp           : " << dictResp["dewp"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] relpress       : " << dictResp["relpress"] << std::endl;
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] pressureSafe   : " << dictResp["pressureSafe"] << std::endl;
-            m_sLogFile.flush();
-#endif
-
-            m_sFirmware = "Solo Cloudwatcher " + dictResp["cwinfo"];
-            m_nCloudCondition = std::stoi(dictResp["cloudsSafe"]);
-            m_dSkyTemp = std::stod(dictResp["clouds"]);
-            m_dTemp = std::stod(dictResp["temp"]);
-
-            m_dWindSpeed = std::stod(dictResp["wind"]);
-            m_nWindCondition = std::stoi(dictResp["windSafe"]);
-            m_dWindGust = std::stod(dictResp["gust"]);
-            m_nRainCondition = std::stoi(dictResp["rainSafe"]);
-            m_nLightCondition = std::stoi(dictResp["lightSafe"]);
-            m_nOverallConditionSafe = std::stoi(dictResp["safe"]);
-
-            m_nPercentHumdity = std::stoi(dictResp["hum"]);
-            m_nHumdityCondition = std::stoi(dictResp["humSafe"]);
-            m_dDewPointTemp = std::stod(dictResp["dewp"]);
-
-            m_dBarometricPressure = std::stod(dictResp["relpress"]);
-            m_nBarometricPressureCondition = std::stoi(dictResp["pressureSafe"]);
+    // a failed poll leaves the good data time alone, the last reading just keeps aging
+    if(res != CURLE_OK) {
+        if(res == CURLE_OPERATION_TIMEDOUT) {
+            // the session already backed its deadline off for the next attempt
+            SOLO_LOG(LOG_CAT_TRANSPORT, LOG_ERROR, "[finishPoll] timed out, next deadline %.0f ms (srtt %.1f ms)", m_Session.getRequestTimeout(), m_Session.getSmoothedRtt());
+            m_Metrics.recordError(POLL_ERROR_TIMEOUT);
         }
         else {
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] SoloCloudwatcher parsing error : " << SoloCloudwatcherError << std::endl;
-            m_sLogFile.flush();
-#endif
-            return ERR_CMDFAILED;
+            SOLO_LOG(LOG_CAT_TRANSPORT, LOG_ERROR, "[finishPoll] Error = %d", int(res));
+            m_Metrics.recordError(POLL_ERROR_TRANSFER);
         }
+        m_ConnectionState.onFailure();
+    }
+    else if(processResponse() == PLUGIN_OK)
+        m_ConnectionState.onSuccess();
+    else
+        m_ConnectionState.onFailure();
+
+    // a poll that published already aged the windows, this catches the others
+    expireStats();
+
+    // while backing off the next attempt waits for the retry deadline instead of the period
+    m_PollScheduler.endPoll();
+    m_PollScheduler.defer(m_ConnectionState.retryDeadline());
+    return false;
+}
+
+// called from finishPoll on the engine thread
+int CSoloCloudwatcher::processResponse()
+{
+    int nErr = PLUGIN_OK;
+    PollTimings timings;
+    const std::string &sBody = m_Session.response();
+    const char *pDataTime;
+    const char *pDataTimeEnd;
+    uint64_t nFingerprint;
+    int64_t nDataTimeMs;
+    int64_t nNowMs;
+    int64_t nAgeMs;
+    AdaptiveLimits limits;
+
+    m_Session.getTimings(timings.dPhase[PHASE_DNS], timings.dPhase[PHASE_CONNECT], timings.dPhase[PHASE_FIRST_BYTE], timings.dPhase[PHASE_TOTAL]);
+
+    // The device updates its readings less often than it's polled. A body identical to the
+    // last one, down to its dataGMTTime, is the same sample : it isn't parsed or published
+    // again, so the good data time keeps aging until the sensors really report.
+    CScopedTimer parseTimer(timings.dPhase[PHASE_PARSE]);
+    nFingerprint = CCloudwatcherParser::fingerprint(sBody.data(), sBody.size());
+    if(!CCloudwatcherParser::findValue(sBody.data(), sBody.size(), DATA_TIME_KEY, pDataTime, pDataTimeEnd))
+        pDataTime = pDataTimeEnd = sBody.data();
+    if(m_nBodyFingerprint && nFingerprint == m_nBodyFingerprint &&
+       m_sDataTime.compare(0, std::string::npos, pDataTime, pDataTimeEnd - pDataTime) == 0) {
+        parseTimer.stop();
+        timings.dPhase[PHASE_PUBLISH] = 0;
+        m_Metrics.record(timings);
+        m_Metrics.recordUnchanged();
+        SOLO_LOG(LOG_CAT_PARSE, LOG_DEBUG, "[processResponse] unchanged sample, data time : %s", m_sDataTime.c_str());
+        return PLUGIN_OK;
+    }
+
+    // parse straight out of the session buffer, a key missing or malformed only costs that field
+    nErr = parseFields(sBody.data(), sBody.size());
+    parseTimer.stop();
+    if(nErr) {
+        SOLO_LOG(LOG_CAT_PARSE, LOG_ERROR, "[processResponse] SoloCloudwatcher parsing error, fields mask : 0x%x", (unsigned int)m_Parsed.nFieldMask);
+        SOLO_LOG(LOG_CAT_PARSE, LOG_ERROR, "[processResponse] response : %s", m_Session.response().c_str());
+        m_Metrics.recordError(POLL_ERROR_PARSE);
+        return PARSE_FAILED;
     }
-    catch (const std::exception& e) {
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] exception : " << e.what() << std::endl;
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] exception response : " << response_string << std::endl;
-        m_sLogFile.flush();
-#endif
-        return ERR_CMDFAILED;
+    if((m_Parsed.nFieldMask & FIELD_MASK_SAFETY) != FIELD_MASK_SAFETY)
+        SOLO_LOG(LOG_CAT_PARSE, LOG_ERROR, "[processResponse] safety fields missing, mask : 0x%x, the good data age keeps growing", (unsigned int)(FIELD_MASK_SAFETY & ~m_Parsed.nFieldMask));
+    else if((m_Parsed.nFieldMask & FIELD_MASK_REQUIRED) != FIELD_MASK_REQUIRED)
+        SOLO_LOG(LOG_CAT_PARSE, LOG_INFO, "[processResponse] partial sample, missing fields mask : 0x%x", (unsigned int)(FIELD_MASK_REQUIRED & ~m_Parsed.nFieldMask));
+    m_nBodyFingerprint = nFingerprint;
+    m_sDataTime.assign(pDataTime, pDataTimeEnd - pDataTime);
+
+    // the request's midpoint and delay from the start of the transfer proper, connection setup excluded
+    nAgeMs = -1;
+    if(CCloudwatcherParser::parseDataTime(pDataTime, pDataTimeEnd, nDataTimeMs)) {
+        nNowMs = CHistoryRing::nowMs();
+        m_ClockOffset.add(nDataTimeMs,
+                          double(nNowMs) - timings.dPhase[PHASE_TOTAL] + (timings.dPhase[PHASE_CONNECT] + timings.dPhase[PHASE_FIRST_BYTE]) / 2.0,
+                          timings.dPhase[PHASE_FIRST_BYTE] - timings.dPhase[PHASE_CONNECT]);
+        nAgeMs = m_ClockOffset.getAge(nDataTimeMs, nNowMs);
+        SOLO_LOG(LOG_CAT_PARSE, LOG_DEBUG, "[processResponse] data time : %s, clock offset %.0f +/- %.0f ms, age %lld ms",
+                 m_sDataTime.c_str(), m_ClockOffset.getOffset(), m_ClockOffset.getUncertainty(), (long long)nAgeMs);
+    }
+
+    {
+        CScopedTimer publishTimer(timings.dPhase[PHASE_PUBLISH]);
+        publishData(nAgeMs);
+    }
+    m_Metrics.record(timings);
+
+    if(m_bAdaptivePolling) {
+        // the scheduler uses the new interval for the deadline that follows this poll, from the fields it returned
+        m_AdaptiveLimits.load(limits);
+        m_PollScheduler.setInterval(m_AdaptivePollRate.update(m_Record, m_Parsed.nFieldMask, limits, m_dAdaptiveMinInterval, m_dAdaptiveMaxInterval));
+        SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[processResponse] adaptive risk : %g interval : %g s", m_AdaptivePollRate.getRisk(), m_PollScheduler.getInterval());
     }
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_sFirmware                    : " << m_sFirmware << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nCloudCondition              : " << m_nCloudCondition << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dSkyTemp                     : " << m_dSkyTemp << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dTemp                        : " << m_dTemp << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dWindSpeed                   : " << m_dWindSpeed << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nWindCondition               : " << m_nWindCondition << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dWindGust                    : " << m_dWindGust << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nRainCondition               : " << m_nRainCondition << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nLightCondition              : " << m_nLightCondition << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nOverallConditionSafe        : " << m_nOverallConditionSafe << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nPercentHumdity              : " << m_nPercentHumdity << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nHumdityCondition            : " << m_nHumdityCondition << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dDewPointTemp                : " << m_dDewPointTemp << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_dBarometricPressure          : " << m_dBarometricPressure << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getData] m_nBarometricPressureCondition : " << m_nBarometricPressureCondition << std::endl;
-
-    m_sLogFile.flush();
-#endif
+    SOLO_LOG(LOG_CAT_PARSE, LOG_DEBUG, "[processResponse] firmware : %s clouds : %d sky : %g temp : %g wind : %g (%d) gust : %g rain : %d light : %d safe : %d humidity : %d (%d) dew point : %g pressure : %g (%d)",
+             m_Record.sFirmware, m_Record.nCloudCondition, m_Record.dSkyTemp, m_Record.dTemp,
+             m_Record.dWindSpeed, m_Record.nWindCondition, m_Record.dWindGust,
+             m_Record.nRainCondition, m_Record.nLightCondition, m_Record.nOverallConditionSafe,
+             m_Record.nPercentHumdity, m_Record.nHumdityCondition, m_Record.dDewPointTemp,
+             m_Record.dBarometricPressure, m_Record.nBarometricPressureCondition);
 
     return nErr;
 }
 
+// Only this step is synchronized with Connect/Disconnect, the network I/O and parsing are not.
+// nAgeMs is how old the reading is going by the device's timestamp, -1 if it had none.
+void CSoloCloudwatcher::publishData(int64_t nAgeMs)
+{
+    WeatherSnapshot snapshot;
+    HistorySample sample;
+    int64_t nNowMs = CMonoClock::nowMs();
+    int64_t nFieldTimeMs;
+    int i;
+    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
+
+    if(!m_bIsConnected)
+        return;
+
+    // only the fields this poll got right replace their last good value
+    CCloudwatcherParser::merge(m_Parsed, m_Record);
+    nFieldTimeMs = nNowMs - (nAgeMs > 0 ? nAgeMs : 0);
+    if(nFieldTimeMs < 1)
+        nFieldTimeMs = 1;
+    for(i = 0; i < FIELD_COUNT; i++) {
+        if(m_Parsed.nFieldMask & FIELD_BIT(i))
+            m_nFieldTimeMs[i] = nFieldTimeMs;
+    }
+
+    // publish all readings at once so readers never mix two polls
+    snapshot.record = m_Record;
+    snapshot.dRequestTime = m_Session.getRequestTime();
+    snapshot.bRestored = false;
+    snapshot.nUpdatedMask = m_Parsed.nFieldMask;
+    memcpy(snapshot.nFieldTimeMs, m_nFieldTimeMs, sizeof(snapshot.nFieldTimeMs));
+    m_RollingStats.add(m_Record, m_Parsed.nFieldMask, nNowMs);
+    m_RollingStats.get(snapshot.stats);
+    // the age first, a reader that sees the new snapshot never gets the previous one's age
+    updateGoodDataTime();
+    m_Snapshot.store(snapshot);
+
+    m_nPublishedTimeMs = CHistoryRing::nowMs();
+    m_nSampleTimeMs = m_nPublishedTimeMs - (nAgeMs > 0 ? nAgeMs : 0);
+    CHistoryRing::makeSample(m_Record, m_Parsed.nFieldMask, m_nPublishedTimeMs, sample);
+    m_History.append(sample);
+    m_Archive.append(sample);
+
+    if(nNowMs - m_nSnapshotSaveMs >= SNAPSHOT_SAVE_PERIOD * 1000)
+        saveSnapshot(m_Record);
+}
+
+// Failed polls and unchanged samples don't publish, the rolling windows still move with time.
+// When samples fall out of them the last snapshot is published again with the new stats, its
+// readings and ages untouched.
+void CSoloCloudwatcher::expireStats()
+{
+    WeatherSnapshot snapshot;
+    const std::lock_guard<std::mutex> lock(m_DevAccessMutex);
+
+    if(!m_bIsConnected || !m_RollingStats.expire(CMonoClock::nowMs()))
+        return;
+    // only this thread stores, the load can't race with a store
+    if(!m_Snapshot.load(snapshot))
+        return;
+    snapshot.nUpdatedMask = 0;
+    m_RollingStats.get(snapshot.stats);
+    m_Snapshot.store(snapshot);
+}
+
+// called with m_DevAccessMutex held
+// written on the disk writer from copies, the caller doesn't wait for the file
+void CSoloCloudwatcher::saveSnapshot(const SoloCloudwatcherRecord &record)
+{
+    m_nSnapshotSaveMs = CMonoClock::nowMs();
+    if(m_sSnapshotPath.empty())
+        return;
+
+    const std::string sPath(m_sSnapshotPath);
+    const int64_t nTimeMs = m_nSampleTimeMs;
+    CDiskWriter::instance().post([sPath, record, nTimeMs] {
+        if(CSnapshotFile::save(sPath, record, nTimeMs))
+            SOLO_LOG(LOG_CAT_POLLER, LOG_ERROR, "[saveSnapshot] can't write %s", sPath.c_str());
+    });
+}
+
+// publishes the saved reading as is, getSecondOfGoodData then reports its true age
+bool CSoloCloudwatcher::restoreSnapshot()
+{
+    WeatherSnapshot snapshot;
+    int64_t nTimeMs;
+    int64_t nAgeMs;
+    int i;
+
+    if(m_sSnapshotPath.empty())
+        return false;
+    // a save queued by the previous Disconnect lands first
+    CDiskWriter::instance().drain();
+    if(CSnapshotFile::load(m_sSnapshotPath, snapshot.record, nTimeMs))
+        return false;
+
+    nAgeMs = CHistoryRing::nowMs() - nTimeMs;
+    if(nAgeMs < 0 || nAgeMs > SNAPSHOT_MAX_AGE * 1000) {
+        SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[restoreSnapshot] saved reading is %lld s old, not used", (long long)(nAgeMs / 1000));
+        return false;
+    }
+
+    snapshot.dRequestTime = 0;
+    memset(&snapshot.stats, 0, sizeof(snapshot.stats));
+    snapshot.bRestored = true;
+    // polls that miss a field keep the saved value of it, with the saved reading's age
+    m_Record = snapshot.record;
+    nTimeMs = CMonoClock::nowMs() - nAgeMs;
+    if(nTimeMs < 1)
+        nTimeMs = 1;    // CMonoClock may have started after the reading, 0 means never
+    for(i = 0; i < FIELD_COUNT; i++)
+        m_nFieldTimeMs[i] = (m_Record.nFieldMask & FIELD_BIT(i)) ? nTimeMs : 0;
+    snapshot.nUpdatedMask = 0;
+    memcpy(snapshot.nFieldTimeMs, m_nFieldTimeMs, sizeof(snapshot.nFieldTimeMs));
+    updateGoodDataTime();
+    m_Snapshot.store(snapshot);
+
+    SOLO_LOG(LOG_CAT_POLLER, LOG_INFO, "[restoreSnapshot] serving the saved reading, %lld s old, until the first poll", (long long)(nAgeMs / 1000));
+    return true;
+}
+
 
 #pragma mark - Getter / Setter
 
@@ -447,10 +698,7 @@ void CSoloCloudwatcher::setIpAddress(std::string IpAddress)
     m_sIpAddress = IpAddress;
     m_sBaseUrl = "http://"+m_sIpAddress;
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setIpAddress] New base url : " << m_sBaseUrl << std::endl;
-    m_sLogFile.flush();
-#endif
+    SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[setIpAddress] New base url : %s", m_sBaseUrl.c_str());
 
 }
 
@@ -473,89 +721,14 @@ std::string& CSoloCloudwatcher::rtrim(std::string& str, const std::string& filte
 
 
 
-int CSoloCloudwatcher::parseFields(const std::string sIn, std::map<std::string, std::string> &fieldMap, char cSeparator)
-{
-    int nErr = PLUGIN_OK;
-    unsigned int i=0;
-    std::string sSegment;
-    std::stringstream ssTmp(sIn);
-    std::vector<std::string> svLines;
-    std::vector<std::string> svFields;
-    char lineSep = '\n';
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] Called." << std::endl;
-    m_sLogFile.flush();
-#endif
-    if(sIn.size() == 0)
-        return PARSE_FAILED;
-
-    svLines.clear();
-    // split the string into vector elements
-    while(std::getline(ssTmp, sSegment, lineSep))
-    {
-        svLines.push_back(sSegment);
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 4
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] svLines sSegment " << sSegment <<  std::endl;
-        m_sLogFile.flush();
-#endif
-    }
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 4
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] svLines.size() " << svLines.size() <<  std::endl;
-    m_sLogFile.flush();
-#endif
-
-    if(svLines.size()==0) {
-        nErr = PARSE_FAILED;
-    }
-
-    // now split each vector entry into key,value
-    for(i=0; i<svLines.size(); i++){
-        std::stringstream(svLines[i]).swap(ssTmp);
-        svFields.clear();
-        while(std::getline(ssTmp, sSegment, cSeparator))
-        {
-            svFields.push_back(sSegment);
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 4
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] svFields sSegment " << sSegment <<  std::endl;
-            m_sLogFile.flush();
-#endif
-        }
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 4
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] svFields.size() " << svLines.size() <<  std::endl;
-        m_sLogFile.flush();
-#endif
-
-
-        if(svFields.size()>1) {
-            fieldMap[svFields[0]] = svFields[1];
-        }
-    }
-
-    return nErr;
-}
-
-
-
-#ifdef PLUGIN_DEBUG
-void CSoloCloudwatcher::log(const std::string sLogLine)
+int CSoloCloudwatcher::parseFields(const char *pBuf, size_t nLen)
 {
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [log] " << sLogLine << std::endl;
-    m_sLogFile.flush();
+    SOLO_LOG(LOG_CAT_PARSE, LOG_TRACE, "[parseFields] Called on %u bytes.", (unsigned int)nLen);
 
-}
-
-const std::string CSoloCloudwatcher::getTimeStamp()
-{
-    time_t     now = time(0);
-    struct tm  tstruct;
-    char       buf[80];
-    tstruct = *localtime(&now);
-    std::strftime(buf, sizeof(buf), "%Y-%m-%d.%X", &tstruct);
+    // a partial sample is still published, only a body without a single usable reading fails
+    CCloudwatcherParser::parse(pBuf, nLen, m_Parsed);
+    if(!(m_Parsed.nFieldMask & FIELD_MASK_REQUIRED))
+        return PARSE_FAILED;
 
-    return buf;
+    return PLUGIN_OK;
 }
-#endif
-
@@ -38,24 +38,51 @@
 #include <thread>
 #include <ctime>
 #include <cmath>
-#include <future>
 #include <mutex>
-#include <map>
 
-#include "../../licensedinterfaces/sberrorx.h"
-
-#include "StopWatch.h"
+#include "MonoClock.h"
+#include "HttpSession.h"
+#include "CloudwatcherParser.h"
+#include "SeqLock.h"
+#include "PollScheduler.h"
+#include "AdaptivePollRate.h"
+#include "StationEngine.h"
+#include "PollMetrics.h"
+#include "HistoryRing.h"
+#include "RollingStats.h"
+#include "SampleArchive.h"
+#include "SnapshotFile.h"
+#include "ConnectionState.h"
+#include "ClockOffset.h"
+#include "Logger.h"
+#include "DiskWriter.h"
 
 #define PLUGIN_VERSION      1.06
 
-// #define PLUGIN_DEBUG 3
+#define SOLO_DATA_PATH      "/cgi-bin/cgiLastData"
+#define FIRMWARE_PREFIX     "Solo Cloudwatcher "
+#define FIRMWARE_PREFIX_LEN (sizeof(FIRMWARE_PREFIX) - 1)
+
+#define SNAPSHOT_READ_ATTEMPTS  3
+#define FIELD_MAX_AGE           300     // seconds a field can lag the newest reading and still be served
 
-// error codes
+// error codes, X2WeatherStation maps them to the TheSkyX ones
 enum SoloCloudwatcherErrors {PLUGIN_OK=0, NOT_CONNECTED, CANT_CONNECT, BAD_CMD_RESPONSE, COMMAND_FAILED, COMMAND_TIMEOUT, PARSE_FAILED};
 
 enum SoloCloudwatcherWindUnits {KPH=0, MPS, MPH};
 
-class CSoloCloudwatcher
+// everything read by the X2 side, published as one unit by the poller
+struct WeatherSnapshot
+{
+    SoloCloudwatcherRecord  record;
+    double                  dRequestTime;   // ms, round trip of the request that returned record
+    RollingStats            stats;          // windows ending with record
+    bool                    bRestored;      // record comes from the snapshot file, the device hasn't answered yet
+    uint32_t                nUpdatedMask;   // FIELD_BIT() of the fields this poll sent, the others keep their last good value
+    int64_t                 nFieldTimeMs[FIELD_COUNT];  // CMonoClock time of each field's last good reading, 0 for never
+};
+
+class CSoloCloudwatcher : public CPolledStation
 {
 public:
     CSoloCloudwatcher();
@@ -64,14 +91,41 @@ public:
     int         Connect();
     void        Disconnect(void);
     bool        IsConnected(void) { return m_bIsConnected; }
+    // one of ConnectionStates, lock free, never waits on the device
+    int         getConnectionState() const { return m_ConnectionState.get(); }
+    const CConnectionState  &connectionState() const { return m_ConnectionState; }
     void        getFirmware(std::string &sFirmware);
+    uint32_t    getSnapshot(WeatherSnapshot &snapshot);
+    bool        peekSnapshot(WeatherSnapshot &snapshot);
 
     int         getWindSpeedUnit(int &nUnit);
 
+    void        setPollInterval(double dSeconds);
+    double      getPollInterval();
+    void        setAdaptivePolling(bool bEnabled, double dMinInterval, double dMaxInterval, const AdaptiveLimits &limits);
+    void        getAdaptivePolling(bool &bEnabled, double &dMinInterval, double &dMaxInterval, AdaptiveLimits &limits);
+    void        getPollSchedulerStats(PollSchedulerStats &stats);
+    CPollMetrics    &getMetrics() { return m_Metrics; }
+    // device clock against ours, the data age comes from it once the device has sent a timestamp
+    const CClockOffset  &clockOffset() const { return m_ClockOffset; }
+    // ms, current RTT derived deadline of a request
+    double      getRequestTimeout() { return m_Session.getRequestTimeout(); }
+
+    // every published sample is kept in the history, the capacity can only change while disconnected
+    int         setHistoryCapacity(size_t nCapacity);
+    const CHistoryRing  &getHistory() const { return m_History; }
+    // archive file the samples are appended to, empty for none. Only while disconnected.
+    int         setArchive(const std::string &sPath, size_t nCapacity);
+    // file the last good reading is kept in, so Connect can serve it right away next time. Only while disconnected.
+    int         setSnapshotFile(const std::string &sPath);
+
     std::mutex  m_DevAccessMutex;
-    int         getData();
 
-    static size_t writeFunction(void* ptr, size_t size, size_t nmemb, void* data);
+    // CPolledStation, called from the engine thread
+    CMonoClock::Clock::time_point nextPollDeadline();
+    CURL        *startPoll();
+    bool        finishPoll(CURLcode res);
+    void        appendMetrics(std::string &sOut, MetricsFamily nFamily);
 
     void getIpAddress(std::string &IpAddress);
     void setIpAddress(std::string IpAddress);
@@ -95,55 +149,57 @@ public:
     int     getBarometricPressureCondition();
 
     int     getSafeCondition();
+    // age of the oldest FIELD_MASK_SAFETY field, measured from the device's own timestamp when it
+    // sends one, -1 while one of them was never read
     double  getSecondOfGoodData();
-
-#ifdef PLUGIN_DEBUG
-    void  log(const std::string sLogLine);
-#endif
+    // false for a field the device never sent, or whose last good value is more than FIELD_MAX_AGE
+    // older than the newest one. How old the whole reading is, is getSecondOfGoodData's job.
+    static bool isFieldCurrent(const WeatherSnapshot &snapshot, int nField);
 
 protected:
 
-    bool            m_bIsConnected;
-    std::string     m_sFirmware;
+    std::atomic<bool>   m_bIsConnected;
     std::string     m_sModel;
     double          m_dFirmwareVersion;
 
-    CURL            *m_Curl;
+    CHttpSession    m_Session;
     std::string     m_sBaseUrl;
 
     std::string     m_sIpAddress;
 
-    bool                m_ThreadsAreRunning;
-    std::promise<void> *m_exitSignal;
-    std::future<void>   m_futureObj;
-    std::thread         m_th;
-
-    // SoloCloudwatcher variables
-    std::atomic<int>    m_nCloudCondition;
-    std::atomic<double> m_dSkyTemp;
-    std::atomic<double> m_dTemp;
-
-    std::atomic<double> m_dWindSpeed;
-    std::atomic<int>    m_nWindCondition;
-    std::atomic<double> m_dWindGust;
-
-    std::atomic<int>    m_nRainCondition;
-    std::atomic<int>    m_nLightCondition;
-
-    std::atomic<int>    m_nPercentHumdity;
-    std::atomic<int>    m_nHumdityCondition;
-    std::atomic<double> m_dDewPointTemp;
-
-
-    std::atomic<double> m_dBarometricPressure; // relpress
-    std::atomic<int>    m_nBarometricPressureCondition;
-
-    std::atomic<int>    m_nOverallConditionSafe;
-
-    CStopWatch      m_goodDataTimer;
+    bool                m_bPolling;             // registered with CStationEngine
+    CConnectionState    m_ConnectionState;      // written by the engine thread and Connect/Disconnect
+    CPollScheduler      m_PollScheduler;
+    CAdaptivePollRate   m_AdaptivePollRate;     // engine thread only
+    CPollMetrics        m_Metrics;
+    std::atomic<double> m_dPollInterval;
+    std::atomic<bool>   m_bAdaptivePolling;
+    std::atomic<double> m_dAdaptiveMinInterval;
+    std::atomic<double> m_dAdaptiveMaxInterval;
+    CSeqLock<AdaptiveLimits>    m_AdaptiveLimits;   // stored by setAdaptivePolling, read by the engine thread
+
+    // SoloCloudwatcher variables, m_Snapshot is the only state shared with the X2 side
+    CSeqLock<WeatherSnapshot>   m_Snapshot;
+    CHistoryRing                m_History;
+    CRollingStats               m_RollingStats;     // engine thread only, published in m_Snapshot
+    CSampleArchive              m_Archive;          // written by whoever publishes, under m_DevAccessMutex
+    std::string                 m_sArchivePath;
+    size_t                      m_nArchiveCapacity;
+    void            openArchive();
+    std::string                 m_sSnapshotPath;
+    int64_t                     m_nPublishedTimeMs;     // system_clock time of the last live sample, 0 if none yet
+    int64_t                     m_nSampleTimeMs;        // system_clock time its sensors were read, from the device timestamp
+    int64_t                     m_nSnapshotSaveMs;      // CMonoClock time of the last snapshot save
+    bool            restoreSnapshot();
+    void            saveSnapshot(const SoloCloudwatcherRecord &record);
+
+    std::atomic<int64_t>        m_nGoodDataTime;    // CMonoClock ns, 0 for never, read lock free by getSecondOfGoodData
+    void            updateGoodDataTime();
 
     bool            m_bSafe;
-    int             doGET(std::string sCmd, std::string &sResp);
+    int             processResponse();
+    void            publishData(int64_t nAgeMs);
+    void            expireStats();
     int             getModelName();
     int             getFirmwareVersion();
     
@@ -151,15 +207,13 @@ protected:
     std::string&    ltrim(std::string &str, const std::string &filter);
     std::string&    rtrim(std::string &str, const std::string &filter);
 
-    int             parseFields(const std::string sIn, std::map<std::string, std::string> &fieldMap, char cSeparator);
-
-#ifdef PLUGIN_DEBUG
-    // timestamp for logs
-    const std::string getTimeStamp();
-    std::ofstream m_sLogFile;
-    std::string m_sLogfilePath;
-    std::string m_sPlatform;
-#endif
+    SoloCloudwatcherRecord  m_Record;           // last good value of every field
+    SoloCloudwatcherRecord  m_Parsed;           // the poll being processed, only merged into m_Record for its valid fields
+    int64_t         m_nFieldTimeMs[FIELD_COUNT];
+    uint64_t        m_nBodyFingerprint;     // of the body m_Record was parsed from, 0 for none
+    CClockOffset    m_ClockOffset;          // device clock against ours, written by the engine thread
+    std::string     m_sDataTime;            // its dataGMTTime, empty if it had none
+    int             parseFields(const char *pBuf, size_t nLen);
 
 };
 
@@ -0,0 +1,285 @@
+//
+//  CStationEngine
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide curl multi event loop polling every connected station from one thread.
+
+#include "StationEngine.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+#ifdef SB_WIN_BUILD
+#include <windows.h>
+#endif
+
+#include "PollMetrics.h"
+
+CStationEngine &CStationEngine::instance()
+{
+    static CStationEngine engine;
+    return engine;
+}
+
+CStationEngine::CStationEngine()
+{
+    m_Multi = nullptr;
+    m_nStationCount = 0;
+    m_bRunning = false;
+}
+
+CStationEngine::~CStationEngine()
+{
+    stop();
+}
+
+// The engine thread is started with the first station and stopped with the last one,
+// so there is a single polling thread whatever the number of stations.
+int CStationEngine::addStation(CPolledStation *pStation)
+{
+    const std::lock_guard<std::mutex> lifecycle(m_LifecycleMutex);
+    int nErr;
+
+    if(!m_bRunning) {
+        nErr = start();
+        if(nErr)
+            return nErr;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_PendingMutex);
+        m_PendingAdd.push_back(pStation);
+        m_nStationCount++;
+    }
+    curl_multi_wakeup(m_Multi);
+    return 0;
+}
+
+// Returns once the engine thread has dropped the station, aborting its transfer if one is
+// in flight, so the caller can free the station right after.
+void CStationEngine::removeStation(CPolledStation *pStation)
+{
+    const std::lock_guard<std::mutex> lifecycle(m_LifecycleMutex);
+
+    if(!m_bRunning)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_PendingMutex);
+        m_PendingRemove.push_back(pStation);
+        curl_multi_wakeup(m_Multi);
+        m_PendingDone.wait(lock, [this, pStation] {
+            return std::find(m_PendingRemove.begin(), m_PendingRemove.end(), pStation) == m_PendingRemove.end();
+        });
+        m_nStationCount--;
+    }
+
+    if(!m_nStationCount)
+        stop();
+}
+
+int CStationEngine::getStationCount()
+{
+    const std::lock_guard<std::mutex> lock(m_PendingMutex);
+    return m_nStationCount;
+}
+
+void CStationEngine::setMetricsFile(const std::string &sPath)
+{
+    const std::lock_guard<std::mutex> lock(m_PendingMutex);
+    m_sMetricsFile.assign(sPath);
+}
+
+int CStationEngine::start()
+{
+    m_Multi = curl_multi_init();
+    if(!m_Multi)
+        return -1;
+
+    m_bRunning = true;
+    m_Thread = std::thread(&threadEntry, this);
+    return 0;
+}
+
+void CStationEngine::stop()
+{
+    if(!m_bRunning)
+        return;
+
+    m_bRunning = false;
+    curl_multi_wakeup(m_Multi);
+    m_Thread.join();
+
+    curl_multi_cleanup(m_Multi);
+    m_Multi = nullptr;
+}
+
+void CStationEngine::threadEntry(CStationEngine *pEngine)
+{
+    pEngine->run();
+}
+
+void CStationEngine::run()
+{
+    long nWait;
+    long nCurlTimeout;
+    int nRunning;
+    size_t i;
+
+    // the poll timers run on this thread, the short calibration wait belongs here rather than in a poll
+    CMonoClock::calibrate();
+    m_NextMetricsExport = Clock::now() + std::chrono::seconds(ENGINE_METRICS_PERIOD);
+    while(m_bRunning) {
+        applyPendingChanges();
+
+        curl_multi_perform(m_Multi, &nRunning);
+        completeTransfers();
+
+        if(Clock::now() >= m_NextMetricsExport) {
+            m_NextMetricsExport = Clock::now() + std::chrono::seconds(ENGINE_METRICS_PERIOD);
+            exportMetrics();
+        }
+
+        // sleep until the next station deadline, a curl timeout or a wakeup from add/remove
+        nWait = startDueStations();
+        if(curl_multi_timeout(m_Multi, &nCurlTimeout) == CURLM_OK && nCurlTimeout >= 0 && nCurlTimeout < nWait)
+            nWait = nCurlTimeout;
+        if(nWait > 0)
+            curl_multi_poll(m_Multi, NULL, 0, (int)nWait, NULL);
+    }
+
+    for(i = 0; i < m_Stations.size(); i++) {
+        if(m_Stations[i].pCurl)
+            curl_multi_remove_handle(m_Multi, m_Stations[i].pCurl);
+    }
+    m_Stations.clear();
+    applyPendingChanges();
+}
+
+void CStationEngine::applyPendingChanges()
+{
+    const std::lock_guard<std::mutex> lock(m_PendingMutex);
+    StationEntry entry;
+    size_t i, j;
+
+    for(i = 0; i < m_PendingAdd.size(); i++) {
+        entry.pStation = m_PendingAdd[i];
+        entry.pCurl = nullptr;
+        m_Stations.push_back(entry);
+    }
+    m_PendingAdd.clear();
+
+    if(m_PendingRemove.empty())
+        return;
+
+    for(i = 0; i < m_PendingRemove.size(); i++) {
+        for(j = 0; j < m_Stations.size(); j++) {
+            if(m_Stations[j].pStation != m_PendingRemove[i])
+                continue;
+            // removing the easy handle from the multi handle aborts the transfer
+            if(m_Stations[j].pCurl)
+                curl_multi_remove_handle(m_Multi, m_Stations[j].pCurl);
+            m_Stations.erase(m_Stations.begin() + j);
+            break;
+        }
+    }
+    m_PendingRemove.clear();
+    m_PendingDone.notify_all();
+}
+
+void CStationEngine::completeTransfers()
+{
+    CURLMsg *pMsg;
+    int nMsgs;
+    size_t i;
+
+    while((pMsg = curl_multi_info_read(m_Multi, &nMsgs))) {
+        if(pMsg->msg != CURLMSG_DONE)
+            continue;
+
+        for(i = 0; i < m_Stations.size(); i++) {
+            if(m_Stations[i].pCurl != pMsg->easy_handle)
+                continue;
+            curl_multi_remove_handle(m_Multi, m_Stations[i].pCurl);
+            if(m_Stations[i].pStation->finishPoll(pMsg->data.result))
+                curl_multi_add_handle(m_Multi, m_Stations[i].pCurl);
+            else
+                m_Stations[i].pCurl = nullptr;
+            break;
+        }
+    }
+}
+
+// starts every idle station whose deadline has passed, returns the ms until the next one
+long CStationEngine::startDueStations()
+{
+    Clock::time_point now = Clock::now();
+    Clock::time_point deadline;
+    long nWait = ENGINE_IDLE_WAIT;
+    long nUntil;
+    size_t i;
+
+    for(i = 0; i < m_Stations.size(); i++) {
+        if(m_Stations[i].pCurl)
+            continue;
+
+        deadline = m_Stations[i].pStation->nextPollDeadline();
+        if(deadline <= now) {
+            m_Stations[i].pCurl = m_Stations[i].pStation->startPoll();
+            if(m_Stations[i].pCurl) {
+                curl_multi_add_handle(m_Multi, m_Stations[i].pCurl);
+                nWait = 0;
+            }
+            continue;
+        }
+
+        nUntil = (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+        if(nUntil < nWait)
+            nWait = nUntil;
+    }
+
+    return nWait;
+}
+
+// Written to a temporary file then renamed, so a scraper never reads a half written file.
+void CStationEngine::exportMetrics()
+{
+    std::string sPath;
+    std::string sTmpPath;
+    std::string sOut;
+    FILE *pFile;
+    size_t i;
+    int nFamily;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_PendingMutex);
+        sPath = m_sMetricsFile;
+    }
+    if(sPath.empty())
+        return;
+
+    // family by family, each one's samples from every station right after its HELP/TYPE lines
+    for(nFamily = 0; nFamily < METRICS_FAMILY_COUNT; nFamily++) {
+        CPollMetrics::writePrometheusHeader(sOut, MetricsFamily(nFamily));
+        for(i = 0; i < m_Stations.size(); i++)
+            m_Stations[i].pStation->appendMetrics(sOut, MetricsFamily(nFamily));
+    }
+
+    sTmpPath = sPath + ".tmp";
+    pFile = fopen(sTmpPath.c_str(), "wb");
+    if(!pFile)
+        return;
+    if(fwrite(sOut.data(), 1, sOut.size(), pFile) != sOut.size()) {
+        fclose(pFile);
+        remove(sTmpPath.c_str());
+        return;
+    }
+    fclose(pFile);
+#ifdef SB_WIN_BUILD
+    // rename doesn't replace an existing file on Windows
+    if(!MoveFileExA(sTmpPath.c_str(), sPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+        remove(sTmpPath.c_str());
+#else
+    rename(sTmpPath.c_str(), sPath.c_str());
+#endif
+}
@@ -0,0 +1,95 @@
+//
+//  CStationEngine
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide curl multi event loop polling every connected station from one thread.
+
+#ifndef __StationEngine__
+#define __StationEngine__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#ifndef SB_WIN_BUILD
+#include <curl/curl.h>
+#else
+#include "win_includes/curl.h"
+#endif
+
+#include "MonoClock.h"
+#include "PollMetrics.h"
+
+#define ENGINE_IDLE_WAIT    1000    // ms, longest curl_multi_poll wait when nothing is due
+#define ENGINE_METRICS_PERIOD   10  // seconds between metrics file exports
+
+// Implemented by anything the engine polls. All three calls are made from the engine thread.
+class CPolledStation
+{
+public:
+    virtual ~CPolledStation() {}
+
+    virtual CMonoClock::Clock::time_point nextPollDeadline() = 0;
+    // returns the easy handle to run, or nullptr to skip this deadline
+    virtual CURL    *startPoll() = 0;
+    // returns true to run the same handle again right away
+    virtual bool    finishPoll(CURLcode res) = 0;
+    // appends the station's Prometheus samples of nFamily
+    virtual void    appendMetrics(std::string &sOut, MetricsFamily nFamily) { (void)sOut; (void)nFamily; }
+};
+
+class CStationEngine
+{
+public:
+    static CStationEngine &instance();
+
+    int         addStation(CPolledStation *pStation);
+    void        removeStation(CPolledStation *pStation);
+    int         getStationCount();
+
+    // exports every station's metrics as Prometheus text to sPath, empty to stop
+    void        setMetricsFile(const std::string &sPath);
+
+protected:
+    typedef CMonoClock::Clock Clock;
+
+    struct StationEntry
+    {
+        CPolledStation  *pStation;
+        CURL            *pCurl;     // non null while a transfer is on the multi handle
+    };
+
+    CStationEngine();
+    ~CStationEngine();
+
+    int         start();
+    void        stop();
+    void        run();
+    void        applyPendingChanges();
+    void        completeTransfers();
+    long        startDueStations();
+    void        exportMetrics();
+    static void threadEntry(CStationEngine *pEngine);
+
+    std::mutex                      m_LifecycleMutex;   // serializes addStation / removeStation
+    std::mutex                      m_PendingMutex;
+    std::condition_variable         m_PendingDone;
+    std::vector<CPolledStation*>    m_PendingAdd;
+    std::vector<CPolledStation*>    m_PendingRemove;
+    int                             m_nStationCount;
+    std::string                     m_sMetricsFile;
+
+    // engine thread only
+    std::vector<StationEntry>       m_Stations;
+    Clock::time_point               m_NextMetricsExport;
+
+    CURLM                           *m_Multi;
+    std::thread                     m_Thread;
+    std::atomic<bool>               m_bRunning;
+};
+
+#endif
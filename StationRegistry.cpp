@@ -0,0 +1,199 @@
+//
+//  CStationRegistry
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide table of connected Solo devices, shared by every plugin instance pointing at the same one.
+
+#include "StationRegistry.h"
+
+#include <ctype.h>
+#include <math.h>
+
+CStationRegistry &CStationRegistry::instance()
+{
+    static CStationRegistry registry;
+    return registry;
+}
+
+// Two instances configured with the same device get the same station, so the Solo only
+// sees one poller. curl is initialized with the first station and cleaned up with the last.
+std::shared_ptr<CSoloCloudwatcher> CStationRegistry::acquire(const std::string &sIpAddress, int &nErr)
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    std::string sKey = normalizeBaseUrl(sIpAddress);
+    std::string sHost;
+    std::map<std::string, StationEntry>::iterator it;
+    StationEntry entry;
+
+    nErr = PLUGIN_OK;
+    if(sKey.empty()) {
+        nErr = CANT_CONNECT;
+        return nullptr;
+    }
+
+    it = m_Stations.find(sKey);
+    if(it != m_Stations.end()) {
+        it->second.nRefCount++;
+        return it->second.pStation;
+    }
+
+    if(m_Stations.empty())
+        curl_global_init(CURL_GLOBAL_ALL);
+
+    entry.pStation = std::make_shared<CSoloCloudwatcher>();
+    sHost = sKey.substr(sizeof("http://") - 1);
+    entry.pStation->setIpAddress(sHost);
+    entry.pStation->setHistoryCapacity(m_nHistoryCapacity);
+    if(!m_sArchiveDirectory.empty()) {
+        entry.pStation->setArchive(m_sArchiveDirectory + PATH_SEPARATOR + dataFileName(sHost, ARCHIVE_FILE_EXTENSION), m_nArchiveCapacity);
+        entry.pStation->setSnapshotFile(m_sArchiveDirectory + PATH_SEPARATOR + dataFileName(sHost, SNAPSHOT_FILE_EXTENSION));
+    }
+    nErr = entry.pStation->Connect();
+    if(nErr) {
+        entry.pStation.reset();
+        if(m_Stations.empty())
+            curl_global_cleanup();
+        return nullptr;
+    }
+
+    entry.nRefCount = 1;
+    m_Stations[sKey] = entry;
+    return entry.pStation;
+}
+
+void CStationRegistry::release(std::shared_ptr<CSoloCloudwatcher> &pStation, const void *pOwner)
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    std::map<std::string, StationEntry>::iterator it;
+
+    if(!pStation)
+        return;
+
+    for(it = m_Stations.begin(); it != m_Stations.end(); ++it) {
+        if(it->second.pStation != pStation)
+            continue;
+        if(--it->second.nRefCount == 0) {
+            it->second.pStation->Disconnect();
+            m_Stations.erase(it);
+            if(m_Stations.empty())
+                curl_global_cleanup();
+        }
+        else if(pOwner && it->second.pollSettings.erase(pOwner))
+            applyPollSettings(it->second);
+        break;
+    }
+    pStation.reset();
+}
+
+void CStationRegistry::setPollSettings(const std::shared_ptr<CSoloCloudwatcher> &pStation, const void *pOwner, PollSettings &settings)
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    std::map<std::string, StationEntry>::iterator it;
+
+    clampPollSettings(settings);
+    for(it = m_Stations.begin(); it != m_Stations.end(); ++it) {
+        if(it->second.pStation != pStation)
+            continue;
+        it->second.pollSettings[pOwner] = settings;
+        applyPollSettings(it->second);
+        if(it->second.pollSettings.size() > 1)
+            SOLO_LOG(LOG_CAT_X2, LOG_INFO, "[setPollSettings] %s is shared by %u instances, it polls at the fastest of their settings",
+                     it->first.c_str(), (unsigned int)it->second.pollSettings.size());
+        return;
+    }
+}
+
+// same limits as CSoloCloudwatcher::setPollInterval and setAdaptivePolling
+void CStationRegistry::clampPollSettings(PollSettings &settings)
+{
+    settings.dInterval = fmin(fmax(settings.dInterval, POLL_INTERVAL_MIN), POLL_INTERVAL_MAX);
+    settings.dMinInterval = fmin(fmax(settings.dMinInterval, POLL_INTERVAL_MIN), POLL_INTERVAL_MAX);
+    settings.dMaxInterval = fmin(fmax(settings.dMaxInterval, settings.dMinInterval), POLL_INTERVAL_MAX);
+    CAdaptivePollRate::clampLimits(settings.limits);
+}
+
+// Shortest fixed interval and shortest adaptive bounds. Adaptive polling can slow the station
+// down, so it only runs while every instance asks for it, and speeds up from the lowest unsafe
+// boundaries over the widest margins asked. Called with m_RegistryMutex held.
+void CStationRegistry::applyPollSettings(StationEntry &entry)
+{
+    std::map<const void *, PollSettings>::const_iterator it;
+    PollSettings combined;
+
+    if(entry.pollSettings.empty())
+        return;
+
+    combined = entry.pollSettings.begin()->second;
+    for(it = entry.pollSettings.begin(); it != entry.pollSettings.end(); ++it) {
+        combined.dInterval = fmin(combined.dInterval, it->second.dInterval);
+        combined.bAdaptive = combined.bAdaptive && it->second.bAdaptive;
+        combined.dMinInterval = fmin(combined.dMinInterval, it->second.dMinInterval);
+        combined.dMaxInterval = fmin(combined.dMaxInterval, it->second.dMaxInterval);
+        combined.limits.dSkyDeltaUnsafe = fmin(combined.limits.dSkyDeltaUnsafe, it->second.limits.dSkyDeltaUnsafe);
+        combined.limits.dSkyDeltaMargin = fmax(combined.limits.dSkyDeltaMargin, it->second.limits.dSkyDeltaMargin);
+        combined.limits.dGustUnsafe = fmin(combined.limits.dGustUnsafe, it->second.limits.dGustUnsafe);
+        combined.limits.dGustMargin = fmax(combined.limits.dGustMargin, it->second.limits.dGustMargin);
+        combined.limits.dHumidityUnsafe = fmin(combined.limits.dHumidityUnsafe, it->second.limits.dHumidityUnsafe);
+        combined.limits.dHumidityMargin = fmax(combined.limits.dHumidityMargin, it->second.limits.dHumidityMargin);
+    }
+
+    entry.pStation->setPollInterval(combined.dInterval);
+    entry.pStation->setAdaptivePolling(combined.bAdaptive, combined.dMinInterval, combined.dMaxInterval, combined.limits);
+}
+
+void CStationRegistry::setHistoryCapacity(size_t nCapacity)
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    m_nHistoryCapacity = nCapacity;
+}
+
+void CStationRegistry::setArchive(const std::string &sDirectory, size_t nCapacity)
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    m_sArchiveDirectory = sDirectory;
+    m_nArchiveCapacity = nCapacity;
+}
+
+int CStationRegistry::getStationCount()
+{
+    const std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    return int(m_Stations.size());
+}
+
+// "192.168.0.10", " HTTP://192.168.0.10:80/ " and "http://192.168.0.10" are the same device
+std::string CStationRegistry::normalizeBaseUrl(const std::string &sIpAddress)
+{
+    std::string sHost;
+    size_t nStart = 0;
+    size_t nEnd = sIpAddress.size();
+    size_t i;
+
+    while(nStart < nEnd && isspace((unsigned char)sIpAddress[nStart]))
+        nStart++;
+    while(nEnd > nStart && (isspace((unsigned char)sIpAddress[nEnd-1]) || sIpAddress[nEnd-1] == '/'))
+        nEnd--;
+
+    for(i = nStart; i < nEnd; i++)
+        sHost += char(tolower((unsigned char)sIpAddress[i]));
+
+    if(sHost.compare(0, 7, "http://") == 0)
+        sHost.erase(0, 7);
+    if(sHost.size() > 3 && sHost.compare(sHost.size() - 3, 3, ":80") == 0)
+        sHost.erase(sHost.size() - 3);
+
+    if(sHost.empty())
+        return sHost;
+    return "http://" + sHost;
+}
+
+// "SoloCloudwatcher_192.168.0.10.arc", anything that isn't safe in a file name becomes '_'
+std::string CStationRegistry::dataFileName(const std::string &sHost, const char *pszExtension)
+{
+    std::string sName = DATA_FILE_PREFIX;
+    size_t i;
+
+    for(i = 0; i < sHost.size(); i++)
+        sName += (isalnum((unsigned char)sHost[i]) || sHost[i] == '.' || sHost[i] == '-') ? sHost[i] : '_';
+    sName += pszExtension;
+    return sName;
+}
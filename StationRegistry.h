@@ -0,0 +1,72 @@
+//
+//  CStationRegistry
+//
+//  SoloCloudwatcher X2 plugin
+//  Process wide table of connected Solo devices, shared by every plugin instance pointing at the same one.
+
+#ifndef __StationRegistry__
+#define __StationRegistry__
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "SoloCloudwatcher.h"
+
+#define DATA_FILE_PREFIX    "SoloCloudwatcher_"
+
+// what one plugin instance asks of its station's poller
+struct PollSettings
+{
+    double  dInterval;          // seconds, fixed rate
+    bool    bAdaptive;
+    double  dMinInterval;       // seconds, adaptive bounds
+    double  dMaxInterval;
+    AdaptiveLimits  limits;     // adaptive unsafe boundaries and margins
+};
+
+class CStationRegistry
+{
+public:
+    static CStationRegistry &instance();
+
+    // returns a connected station for sIpAddress, nullptr and nErr set if it can't connect
+    std::shared_ptr<CSoloCloudwatcher>  acquire(const std::string &sIpAddress, int &nErr);
+    // drops the handle and pOwner's poll settings, the last one disconnects the station
+    void        release(std::shared_ptr<CSoloCloudwatcher> &pStation, const void *pOwner = nullptr);
+    // Poll settings belong to the station, so instances sharing one register theirs under their
+    // own pOwner and the station runs the combination that polls none of them slower than asked.
+    // settings comes back clamped to the poller's limits.
+    void        setPollSettings(const std::shared_ptr<CSoloCloudwatcher> &pStation, const void *pOwner, PollSettings &settings);
+
+    int         getStationCount();
+    // history size of the stations created from now on, existing ones keep theirs
+    void        setHistoryCapacity(size_t nCapacity);
+    // archive and snapshot files of the stations created from now on go in sDirectory, one of each
+    // per device. An empty directory disables both, a 0 capacity only the archive.
+    void        setArchive(const std::string &sDirectory, size_t nCapacity);
+    static std::string normalizeBaseUrl(const std::string &sIpAddress);
+    static std::string dataFileName(const std::string &sHost, const char *pszExtension);
+
+protected:
+    struct StationEntry
+    {
+        std::shared_ptr<CSoloCloudwatcher>  pStation;
+        int                                 nRefCount;
+        std::map<const void *, PollSettings> pollSettings;  // by owner
+    };
+
+    static void clampPollSettings(PollSettings &settings);
+    static void applyPollSettings(StationEntry &entry);
+
+    CStationRegistry() { m_nHistoryCapacity = HISTORY_CAPACITY_DEFAULT; m_nArchiveCapacity = 0; }
+
+    std::mutex                          m_RegistryMutex;
+    std::map<std::string, StationEntry> m_Stations;     // keyed by normalized base url
+    size_t                              m_nHistoryCapacity;
+    std::string                         m_sArchiveDirectory;
+    size_t                              m_nArchiveCapacity;
+};
+
+#endif
@@ -0,0 +1,657 @@
+//
+//  solocw-bench
+//
+//  SoloCloudwatcher X2 plugin
+//  Benchmarks of the core library's hot paths : parsing, the snapshot seqlock, UI value
+//  formatting and whole poll cycles against in-process mock devices on loopback. Results are
+//  written as JSON, per operation times are the median and the fastest of many timed batches.
+//
+//  usage : solocw-bench [-o file] [-t seconds] [-s stations] [-d duration] [-f filter]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <utility>
+
+#include "StationRegistry.h"
+#include "CloudwatcherParser.h"
+#include "SeqLock.h"
+#include "MockSolo.h"
+#include "Logger.h"
+
+#define BENCH_TIME_DEFAULT      0.5     // s of timed batches per micro benchmark
+#define BENCH_BATCH_MS          1.0     // a batch runs at least this long, so clock reads don't count
+#define BENCH_STATIONS_DEFAULT  64
+#define BENCH_POLL_DURATION     3.0     // s of polling in the poll cycle benchmark
+#define BENCH_POLL_WARMUP       1.0     // s of polling before, connections and first samples aren't counted
+#define BENCH_POLL_CHECK        20      // ms between snapshot version checks
+#define BENCH_READERS           3       // threads reading the seqlock while one stores
+
+typedef std::vector<std::pair<std::string, double> > BenchExtras;
+
+struct BenchResult
+{
+    std::string sName;
+    uint64_t    nIterations;
+    double      dNsPerOp;           // median of the batches
+    double      dNsPerOpMin;
+    BenchExtras extras;
+};
+
+struct BenchOptions
+{
+    double      dTime;
+    int         nStations;
+    double      dPollDuration;
+    std::string sFilter;
+};
+
+static volatile uint64_t s_nSink;
+static std::vector<BenchResult> s_Results;
+static BenchOptions s_Options;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool selected(const char *pszName)
+{
+    return s_Options.sFilter.empty() || strstr(pszName, s_Options.sFilter.c_str());
+}
+
+// Doubles the batch size until one batch takes BENCH_BATCH_MS, then times batches for
+// s_Options.dTime. fn(n) runs the operation n times.
+template <typename F>
+static BenchResult &measure(const char *pszName, F fn)
+{
+    std::vector<double> batches;
+    BenchResult result;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point begin;
+    uint64_t nBatch = 1;
+    double dNs;
+
+    while(true) {
+        start = std::chrono::steady_clock::now();
+        fn(nBatch);
+        if(elapsedNs(start) >= BENCH_BATCH_MS * 1e6 || nBatch >= (uint64_t(1) << 30))
+            break;
+        nBatch *= 2;
+    }
+
+    result.sName.assign(pszName);
+    result.nIterations = 0;
+    begin = std::chrono::steady_clock::now();
+    do {
+        start = std::chrono::steady_clock::now();
+        fn(nBatch);
+        dNs = elapsedNs(start);
+        batches.push_back(dNs / double(nBatch));
+        result.nIterations += nBatch;
+    } while(elapsedNs(begin) < s_Options.dTime * 1e9);
+
+    std::sort(batches.begin(), batches.end());
+    result.dNsPerOp = batches[batches.size() / 2];
+    result.dNsPerOpMin = batches[0];
+    s_Results.push_back(result);
+    fprintf(stderr, "%-36s %12.1f ns/op  (min %.1f, %llu ops)\n", pszName, result.dNsPerOp, result.dNsPerOpMin,
+            (unsigned long long)result.nIterations);
+    return s_Results.back();
+}
+
+static void addExtra(BenchResult &result, const char *pszKey, double dValue)
+{
+    result.extras.push_back(std::make_pair(std::string(pszKey), dValue));
+    fprintf(stderr, "%-36s %12.3f %s\n", "", dValue, pszKey);
+}
+
+static double cpuSeconds()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static double percentile(std::vector<double> &values, double dQuantile)
+{
+    if(values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(dQuantile * double(values.size())))];
+}
+
+#pragma mark - bodies
+
+static std::string realisticBody()
+{
+    MockSoloConfig config;
+
+    CMockSolo::defaultConfig(config);
+    return "dataGMTTime=2026/10/17 21:30:05\n" + config.readings[0];
+}
+
+// What a misbehaving device or proxy could send within SESSION_MAX_RESPONSE : CRLF line
+// ends, keys the parser doesn't know, near misses of the ones it does, lines without '=',
+// very long values and numbers, with the required keys last so every line is scanned.
+static std::string adversarialBody()
+{
+    std::string sBody;
+    std::string sRealistic = realisticBody();
+    char szLine[256];
+    int i;
+
+    for(i = 0; sBody.size() < 60000; i++) {
+        switch(i % 6) {
+            case 0: snprintf(szLine, sizeof(szLine), "unknownKey%d=%d.%d\r\n", i, i, i); break;
+            case 1: snprintf(szLine, sizeof(szLine), "cloudsSafeX=%d\r\n", i); break;
+            case 2: snprintf(szLine, sizeof(szLine), "no separator on this line %d\r\n", i); break;
+            case 3: snprintf(szLine, sizeof(szLine), "temp=-000000000000000000000000000012.3456789012345678901234e-0000001x\r\n"); break;
+            case 4: snprintf(szLine, sizeof(szLine), "%.*s=%.*s\r\n", 60, "wwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwwww", 120,
+                             "9999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999999"); break;
+            default: snprintf(szLine, sizeof(szLine), "=\r\n"); break;
+        }
+        sBody.append(szLine);
+    }
+    sBody += sRealistic;
+    return sBody;
+}
+
+#pragma mark - benchmarks
+
+static void benchParse()
+{
+    SoloCloudwatcherRecord record;
+    std::string sRealistic = realisticBody();
+    std::string sAdversarial = adversarialBody();
+
+    if(selected("parse_realistic")) {
+        BenchResult &result = measure("parse_realistic", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                CCloudwatcherParser::parse(sRealistic.data(), sRealistic.size(), record);
+                s_nSink += record.nFieldMask;
+            }
+        });
+        addExtra(result, "bytes", double(sRealistic.size()));
+    }
+    if(selected("parse_adversarial")) {
+        BenchResult &result = measure("parse_adversarial", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                CCloudwatcherParser::parse(sAdversarial.data(), sAdversarial.size(), record);
+                s_nSink += record.nFieldMask;
+            }
+        });
+        addExtra(result, "bytes", double(sAdversarial.size()));
+        addExtra(result, "mb_per_s", double(sAdversarial.size()) / result.dNsPerOp * 1e3);
+    }
+    if(selected("fingerprint_realistic")) {
+        measure("fingerprint_realistic", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++)
+                s_nSink += CCloudwatcherParser::fingerprint(sRealistic.data(), sRealistic.size());
+        });
+    }
+}
+
+static void benchSeqLock()
+{
+    CSeqLock<WeatherSnapshot> seqLock;
+    WeatherSnapshot snapshot;
+    WeatherSnapshot copy;
+    std::vector<std::thread> threads;
+    std::atomic<bool> bStop(false);
+    std::atomic<uint64_t> nOtherOps(0);
+    std::string sBody = realisticBody();
+    uint64_t nFailed = 0;
+    uint32_t nVersion = 0;
+    int i;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+    CCloudwatcherParser::parse(sBody.data(), sBody.size(), snapshot.record);
+    seqLock.store(snapshot);
+
+    if(selected("seqlock_publish")) {
+        measure("seqlock_publish", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                snapshot.dRequestTime = double(j);
+                seqLock.store(snapshot);
+            }
+        });
+    }
+    if(selected("seqlock_read")) {
+        measure("seqlock_read", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                seqLock.tryLoad(copy, SNAPSHOT_READ_ATTEMPTS, nVersion);
+                s_nSink += nVersion;
+            }
+        });
+    }
+
+    // one writer storing back to back, far more often than any poll rate
+    if(selected("seqlock_read_contended")) {
+        bStop = false;
+        nOtherOps = 0;
+        threads.push_back(std::thread([&]() {
+            uint64_t nStores = 0;
+            WeatherSnapshot local = snapshot;
+            while(!bStop.load(std::memory_order_relaxed)) {
+                local.dRequestTime = double(nStores++);
+                seqLock.store(local);
+            }
+            nOtherOps = nStores;
+        }));
+        uint64_t nReads = 0;
+        BenchResult &result = measure("seqlock_read_contended", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                if(!seqLock.tryLoad(copy, SNAPSHOT_READ_ATTEMPTS, nVersion))
+                    nFailed++;
+                s_nSink += nVersion;
+            }
+            nReads += n;
+        });
+        bStop = true;
+        threads.back().join();
+        threads.clear();
+        addExtra(result, "failed_read_ratio", double(nFailed) / double(nReads));
+        addExtra(result, "writer_stores", double(nOtherOps));
+    }
+
+    // readers spinning on the snapshot, like several UI timers and the probe at once
+    if(selected("seqlock_publish_contended")) {
+        bStop = false;
+        nOtherOps = 0;
+        for(i = 0; i < BENCH_READERS; i++) {
+            threads.push_back(std::thread([&]() {
+                WeatherSnapshot local;
+                uint32_t nLocalVersion;
+                uint64_t nReads = 0;
+                while(!bStop.load(std::memory_order_relaxed)) {
+                    seqLock.tryLoad(local, SNAPSHOT_READ_ATTEMPTS, nLocalVersion);
+                    nReads++;
+                }
+                nOtherOps += nReads;
+            }));
+        }
+        BenchResult &result = measure("seqlock_publish_contended", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                snapshot.dRequestTime = double(j);
+                seqLock.store(snapshot);
+            }
+        });
+        bStop = true;
+        for(i = 0; i < BENCH_READERS; i++)
+            threads[i].join();
+        threads.clear();
+        addExtra(result, "readers", BENCH_READERS);
+        addExtra(result, "reader_loads", double(nOtherOps));
+    }
+}
+
+// the six numeric fields of one UI refresh, against printf's %.2f which the host's locale can change
+static void benchFormat()
+{
+    SoloCloudwatcherRecord record;
+    std::string sBody = realisticBody();
+    char szTmp[64];
+
+    CCloudwatcherParser::parse(sBody.data(), sBody.size(), record);
+    if(selected("format_ui_refresh")) {
+        measure("format_ui_refresh", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dTemp, " ºC");
+                s_nSink += uint64_t(szTmp[0]);
+                snprintf(szTmp, sizeof(szTmp), "%d %%", record.nPercentHumdity);
+                s_nSink += uint64_t(szTmp[0]);
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dDewPointTemp, " ºC");
+                s_nSink += uint64_t(szTmp[0]);
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dBarometricPressure, " mbar");
+                s_nSink += uint64_t(szTmp[0]);
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dWindSpeed, " km/h");
+                s_nSink += uint64_t(szTmp[0]);
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dWindGust, " km/h");
+                s_nSink += uint64_t(szTmp[0]);
+            }
+        });
+    }
+    if(selected("format_fixed2")) {
+        measure("format_fixed2", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dBarometricPressure + double(i & 7), " mbar");
+                s_nSink += uint64_t(szTmp[0]);
+            }
+        });
+    }
+    if(selected("format_printf")) {
+        measure("format_printf", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                snprintf(szTmp, sizeof(szTmp), "%.2f mbar", record.dBarometricPressure + double(i & 7));
+                s_nSink += uint64_t(szTmp[0]);
+            }
+        });
+    }
+}
+
+// Full polls through the engine : curl on a kept-alive loopback connection, parse and publish.
+// Each station has its own mock serving a new reading with every request, so every poll is
+// parsed and published. The CPU time per poll includes the mocks' side of each request, the
+// request times are those of the samples the version checks saw.
+static void benchPollCycle()
+{
+    std::vector<std::unique_ptr<CMockSolo> > mocks;
+    std::vector<std::shared_ptr<CSoloCloudwatcher> > stations;
+    std::vector<uint32_t> versions;
+    std::vector<double> requestTimes;
+    MockSoloConfig config;
+    WeatherSnapshot snapshot;
+    BenchResult result;
+    uint64_t nPolls = 0;
+    uint64_t nWarmupPolls = 0;
+    uint64_t nErrors = 0;
+    uint64_t nSamples = 0;
+    uint32_t nVersion;
+    double dCpu;
+    double dWall;
+    char szHost[64];
+    int nErr;
+    int i;
+    size_t j;
+
+    if(!selected("poll_cycle"))
+        return;
+
+    CMockSolo::defaultConfig(config);
+    config.nPort = 0;
+    config.dAdvancePeriod = 0;
+    for(i = 0; i < s_Options.nStations; i++) {
+        mocks.push_back(std::unique_ptr<CMockSolo>(new CMockSolo()));
+        nErr = mocks.back()->start(config);
+        if(nErr) {
+            fprintf(stderr, "poll_cycle : mock server, %s\n", strerror(nErr));
+            return;
+        }
+        snprintf(szHost, sizeof(szHost), "127.0.0.1:%d", mocks.back()->getPort());
+        stations.push_back(CStationRegistry::instance().acquire(std::string(szHost), nErr));
+        if(!stations.back()) {
+            fprintf(stderr, "poll_cycle : %s, error %d\n", szHost, nErr);
+            return;
+        }
+        stations.back()->setPollInterval(POLL_INTERVAL_MIN);
+        versions.push_back(0);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(int(BENCH_POLL_WARMUP * 1000)));
+    for(j = 0; j < stations.size(); j++) {
+        versions[j] = stations[j]->getSnapshot(snapshot);
+        nWarmupPolls += stations[j]->getMetrics().getPollCount();
+    }
+
+    dCpu = cpuSeconds();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(elapsedNs(start) < s_Options.dPollDuration * 1e9) {
+        for(j = 0; j < stations.size(); j++) {
+            nVersion = stations[j]->getSnapshot(snapshot);
+            if(nVersion == versions[j])
+                continue;
+            versions[j] = nVersion;
+            nSamples++;
+            requestTimes.push_back(snapshot.dRequestTime);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_POLL_CHECK));
+    }
+    dWall = elapsedNs(start) / 1e9;
+    dCpu = cpuSeconds() - dCpu;
+
+    for(j = 0; j < stations.size(); j++) {
+        CPollMetrics &metrics = stations[j]->getMetrics();
+        nPolls += metrics.getPollCount();
+        for(i = 0; i < POLL_ERROR_COUNT; i++)
+            nErrors += metrics.getErrorCount(PollError(i));
+        CStationRegistry::instance().release(stations[j]);
+    }
+    nPolls -= nWarmupPolls;
+    for(j = 0; j < mocks.size(); j++)
+        mocks[j]->stop();
+
+    result.sName.assign("poll_cycle");
+    result.nIterations = nPolls;
+    result.dNsPerOp = nPolls ? dCpu * 1e9 / double(nPolls) : 0;
+    result.dNsPerOpMin = result.dNsPerOp;
+    s_Results.push_back(result);
+    fprintf(stderr, "%-36s %12.1f ns cpu/poll  (%llu polls)\n", "poll_cycle", result.dNsPerOp, (unsigned long long)nPolls);
+    addExtra(s_Results.back(), "stations", s_Options.nStations);
+    addExtra(s_Results.back(), "polls_per_s", double(nPolls) / dWall);
+    addExtra(s_Results.back(), "samples_seen", double(nSamples));
+    addExtra(s_Results.back(), "errors", double(nErrors));
+    addExtra(s_Results.back(), "request_ms_p50", percentile(requestTimes, 0.5));
+    addExtra(s_Results.back(), "request_ms_p99", percentile(requestTimes, 0.99));
+    addExtra(s_Results.back(), "request_ms_max", percentile(requestTimes, 1.0));
+}
+
+// peekSnapshot while the station polls normally, then while its poll is stuck on a device
+// that takes requests and never answers. The mock is restarted on the same port stalling every
+// request, curl reconnects to it and waits until the request deadline, again and again.
+static void benchStalledRead()
+{
+    std::shared_ptr<CSoloCloudwatcher> pStation;
+    CMockSolo mock;
+    MockSoloConfig config;
+    MockSoloStats stats;
+    WeatherSnapshot snapshot;
+    uint64_t nFailed = 0;
+    uint64_t nTimeouts;
+    char szHost[64];
+    int nErr;
+    int i;
+
+    if(!selected("peek_snapshot"))
+        return;
+
+    CMockSolo::defaultConfig(config);
+    config.nPort = 0;
+    config.dAdvancePeriod = 0;
+    nErr = mock.start(config);
+    if(nErr) {
+        fprintf(stderr, "peek_snapshot : mock server, %s\n", strerror(nErr));
+        return;
+    }
+    snprintf(szHost, sizeof(szHost), "127.0.0.1:%d", mock.getPort());
+    pStation = CStationRegistry::instance().acquire(std::string(szHost), nErr);
+    if(!pStation) {
+        fprintf(stderr, "peek_snapshot : %s, error %d\n", szHost, nErr);
+        return;
+    }
+    pStation->setPollInterval(POLL_INTERVAL_MIN);
+    for(i = 0; i < 500 && !pStation->peekSnapshot(snapshot); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    if(selected("peek_snapshot_polling")) {
+        measure("peek_snapshot_polling", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                if(!pStation->peekSnapshot(snapshot))
+                    nFailed++;
+                s_nSink += snapshot.record.nFieldMask;
+            }
+        });
+        addExtra(s_Results.back(), "failed_peeks", double(nFailed));
+    }
+
+    if(selected("peek_snapshot_stalled")) {
+        config.nPort = mock.getPort();
+        config.nStallPercent = 100;
+        mock.stop();
+        nErr = mock.start(config);
+        if(nErr) {
+            fprintf(stderr, "peek_snapshot_stalled : mock server, %s\n", strerror(nErr));
+            CStationRegistry::instance().release(pStation);
+            return;
+        }
+        for(i = 0; i < 500; i++) {
+            mock.getStats(stats);
+            if(stats.nFaults)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        nFailed = 0;
+        nTimeouts = pStation->getMetrics().getErrorCount(POLL_ERROR_TIMEOUT);
+        measure("peek_snapshot_stalled", [&](uint64_t n) {
+            for(uint64_t j = 0; j < n; j++) {
+                if(!pStation->peekSnapshot(snapshot))
+                    nFailed++;
+                s_nSink += snapshot.record.nFieldMask;
+            }
+        });
+        mock.getStats(stats);
+        addExtra(s_Results.back(), "failed_peeks", double(nFailed));
+        addExtra(s_Results.back(), "stalled_requests", double(stats.nFaults));
+        addExtra(s_Results.back(), "timeouts", double(pStation->getMetrics().getErrorCount(POLL_ERROR_TIMEOUT) - nTimeouts));
+    }
+
+    CStationRegistry::instance().release(pStation);
+    mock.stop();
+}
+
+// SOLO_LOG calls that log nothing : the level off, a category that isn't enabled, and a level
+// above the enabled one. Each loop also stores to the sink, log_baseline is that loop alone.
+static void benchDisabledLog()
+{
+    char szPath[128];
+    double dBaseline = 0;
+    double dValue = 1.5;
+
+    if(!selected("log_"))
+        return;
+
+    if(selected("log_baseline")) {
+        dBaseline = measure("log_baseline", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++)
+                s_nSink += i;
+        }).dNsPerOp;
+    }
+
+    CLogger::instance().setLevel(LOG_OFF);
+    if(selected("log_disabled_level")) {
+        BenchResult &result = measure("log_disabled_level", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                SOLO_LOG(LOG_CAT_POLLER, LOG_DEBUG, "[bench] poll %llu took %.3f ms", (unsigned long long)i, dValue);
+                s_nSink += i;
+            }
+        });
+        addExtra(result, "ns_over_baseline", result.dNsPerOp - dBaseline);
+    }
+
+    // a running writer with only the poller category at debug
+    snprintf(szPath, sizeof(szPath), "/tmp/solocw-bench-%d.log", int(getpid()));
+    CLogger::instance().setPath(std::string(szPath));
+    CLogger::instance().setCategories(1 << LOG_CAT_POLLER);
+    CLogger::instance().setLevel(LOG_DEBUG);
+    CLogger::instance().open();
+    if(selected("log_disabled_category")) {
+        BenchResult &result = measure("log_disabled_category", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                SOLO_LOG(LOG_CAT_PARSE, LOG_DEBUG, "[bench] poll %llu took %.3f ms", (unsigned long long)i, dValue);
+                s_nSink += i;
+            }
+        });
+        addExtra(result, "ns_over_baseline", result.dNsPerOp - dBaseline);
+    }
+    if(selected("log_disabled_trace")) {
+        BenchResult &result = measure("log_disabled_trace", [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                SOLO_LOG(LOG_CAT_POLLER, LOG_TRACE, "[bench] poll %llu took %.3f ms", (unsigned long long)i, dValue);
+                s_nSink += i;
+            }
+        });
+        addExtra(result, "ns_over_baseline", result.dNsPerOp - dBaseline);
+    }
+    CLogger::instance().close();
+    CLogger::instance().setLevel(LOG_OFF);
+    remove(szPath);
+}
+
+#pragma mark - output
+
+static void writeJson(FILE *pFile)
+{
+    size_t i, j;
+
+    fprintf(pFile, "{\n  \"tool\": \"solocw-bench\",\n  \"plugin_version\": %.2f,\n  \"fast_clock\": %s,\n  \"benchmarks\": [\n",
+            PLUGIN_VERSION, CMonoClock::hasFastPath() ? "true" : "false");
+    for(i = 0; i < s_Results.size(); i++) {
+        const BenchResult &result = s_Results[i];
+        fprintf(pFile, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f",
+                result.sName.c_str(), (unsigned long long)result.nIterations, result.dNsPerOp, result.dNsPerOpMin);
+        for(j = 0; j < result.extras.size(); j++)
+            fprintf(pFile, ", \"%s\": %.6g", result.extras[j].first.c_str(), result.extras[j].second);
+        fprintf(pFile, "}%s\n", i + 1 < s_Results.size() ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage : solocw-bench [-o file] [-t seconds] [-s stations] [-d duration] [-f filter]\n");
+    fprintf(stderr, "  -o file      write the JSON results to file instead of stdout\n");
+    fprintf(stderr, "  -t seconds   timed per micro benchmark (default %.1f)\n", BENCH_TIME_DEFAULT);
+    fprintf(stderr, "  -s stations  mock devices polled in the poll cycle benchmark (default %d)\n", BENCH_STATIONS_DEFAULT);
+    fprintf(stderr, "  -d duration  seconds of polling in the poll cycle benchmark (default %.0f)\n", BENCH_POLL_DURATION);
+    fprintf(stderr, "  -f filter    only run the benchmarks whose name contains filter\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *pFile = stdout;
+    const char *pszOutput = NULL;
+    int i;
+
+    CMonoClock::calibrate();
+    s_Options.dTime = BENCH_TIME_DEFAULT;
+    s_Options.nStations = BENCH_STATIONS_DEFAULT;
+    s_Options.dPollDuration = BENCH_POLL_DURATION;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-o") && i + 1 < argc)
+            pszOutput = argv[++i];
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            s_Options.dTime = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+            s_Options.nStations = std::max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+            s_Options.dPollDuration = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+            s_Options.sFilter.assign(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    benchParse();
+    benchSeqLock();
+    benchFormat();
+    benchPollCycle();
+    benchStalledRead();
+    benchDisabledLog();
+
+    if(pszOutput) {
+        pFile = fopen(pszOutput, "w");
+        if(!pFile) {
+            perror(pszOutput);
+            return 1;
+        }
+    }
+    writeJson(pFile);
+    if(pFile != stdout)
+        fclose(pFile);
+    return 0;
+}
@@ -0,0 +1,141 @@
+//
+//  solocw-mock
+//
+//  SoloCloudwatcher X2 plugin
+//  Command line stand-in for a Solo Cloudwatcher, serving /cgi-bin/cgiLastData from a scripted
+//  sequence of readings with optional latency, errors and broken replies, for the plugin,
+//  solocw-probe and load tests. Request counts are printed on stderr every few seconds.
+//
+//  usage : solocw-mock [-p port] [-b address] [-s script] [-a advance] [-l latency] [-j jitter] [-D drip] [-c]
+//                      [-S stall %] [-x drop %] [-e error %] [-t truncate %] [-r seed] [-d duration]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "MockSolo.h"
+
+#define MOCK_REPORT_PERIOD  5       // s between request counts on stderr
+
+static std::atomic<bool> s_bStop(false);
+
+static void onSignal(int)
+{
+    s_bStop = true;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage : solocw-mock [-p port] [-b address] [-s script] [-a advance] [-l latency] [-j jitter] [-D drip] [-c]\n");
+    fprintf(stderr, "                    [-S stall %%] [-x drop %%] [-e error %%] [-t truncate %%] [-r seed] [-d duration]\n");
+    fprintf(stderr, "  -p port      to listen on, 0 picks a free one (default %d)\n", MOCK_PORT_DEFAULT);
+    fprintf(stderr, "  -b address   IPv4 address to bind (default 127.0.0.1)\n");
+    fprintf(stderr, "  -s script    key=value readings separated by lines of ---, '#' starts a comment (default built in)\n");
+    fprintf(stderr, "  -a seconds   each reading is served, 0 moves on with every request (default 5)\n");
+    fprintf(stderr, "  -l ms        latency before each reply (default 0)\n");
+    fprintf(stderr, "  -j ms        random latency added to -l (default 0)\n");
+    fprintf(stderr, "  -D ms        between %d byte chunks of each body, 0 sends it at once (default 0)\n", MOCK_DRIP_CHUNK);
+    fprintf(stderr, "  -c           replies without Content-Length, ended by closing the connection\n");
+    fprintf(stderr, "  -S percent   of requests never answered\n");
+    fprintf(stderr, "  -x percent   of requests closed without a reply\n");
+    fprintf(stderr, "  -e percent   of requests answered with HTTP 500\n");
+    fprintf(stderr, "  -t percent   of bodies cut in half, with -c the client can only tell from the last line\n");
+    fprintf(stderr, "  -r seed      for the latency and fault draws (default 1)\n");
+    fprintf(stderr, "  -d duration  seconds to run, 0 runs until interrupted (default 0)\n");
+}
+
+static void printStats(CMockSolo &mock, double dTime)
+{
+    MockSoloStats stats;
+
+    mock.getStats(stats);
+    fprintf(stderr, "%.1f s : %llu connections, %llu requests, %llu replies, %llu faults\n", dTime,
+            (unsigned long long)stats.nConnections, (unsigned long long)stats.nRequests,
+            (unsigned long long)stats.nReplies, (unsigned long long)stats.nFaults);
+}
+
+int main(int argc, char **argv)
+{
+    CMockSolo mock;
+    MockSoloConfig config;
+    double dDuration = 0;
+    double dTime;
+    double dNextReport = MOCK_REPORT_PERIOD;
+    int nErr;
+    int i;
+
+    CMockSolo::defaultConfig(config);
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-p") && i + 1 < argc)
+            config.nPort = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-b") && i + 1 < argc)
+            config.sBindAddress.assign(argv[++i]);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc) {
+            nErr = CMockSolo::loadScript(std::string(argv[++i]), config.readings);
+            if(nErr) {
+                fprintf(stderr, "%s : no readings, %s\n", argv[i], strerror(nErr));
+                return 1;
+            }
+        }
+        else if(!strcmp(argv[i], "-a") && i + 1 < argc)
+            config.dAdvancePeriod = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-l") && i + 1 < argc)
+            config.nLatencyMs = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-j") && i + 1 < argc)
+            config.nJitterMs = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-D") && i + 1 < argc)
+            config.nDripMs = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-c"))
+            config.bCloseDelimited = true;
+        else if(!strcmp(argv[i], "-S") && i + 1 < argc)
+            config.nStallPercent = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-x") && i + 1 < argc)
+            config.nDropPercent = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-e") && i + 1 < argc)
+            config.nErrorPercent = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc)
+            config.nTruncatePercent = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+            config.nSeed = unsigned(atol(argv[++i]));
+        else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+            dDuration = atof(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    nErr = mock.start(config);
+    if(nErr) {
+        fprintf(stderr, "%s:%d : %s\n", config.sBindAddress.c_str(), config.nPort, strerror(nErr));
+        return 1;
+    }
+    // the port on stdout so scripts starting it with -p 0 can pick it up
+    printf("%d\n", mock.getPort());
+    fflush(stdout);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(!s_bStop) {
+        dTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(dDuration > 0 && dTime >= dDuration)
+            break;
+        if(dTime >= dNextReport) {
+            printStats(mock, dTime);
+            dNextReport += MOCK_REPORT_PERIOD;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    mock.stop();
+    printStats(mock, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
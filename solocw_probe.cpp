@@ -0,0 +1,201 @@
+//
+//  solocw-probe
+//
+//  SoloCloudwatcher X2 plugin
+//  Command line tool polling one or more Solo Cloudwatchers through the core library,
+//  for capacity tests and site diagnostics. Samples are streamed as CSV on stdout.
+//
+//  usage : solocw-probe [-i interval] [-d duration] [-m metrics file] [-H history size] [-a archive directory] host [host ...]
+//          solocw-probe -r archive file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "StationRegistry.h"
+
+#define PROBE_CHECK_PERIOD  10      // ms between snapshot version checks
+#define PROBE_TREND_PERIOD  (15*60*1000)    // ms of history summarized on exit
+
+struct ProbeStation
+{
+    std::string                         sHost;
+    std::shared_ptr<CSoloCloudwatcher>  pStation;
+    uint32_t                            nVersion;
+    uint64_t                            nSamples;
+};
+
+static std::atomic<bool> s_bStop(false);
+
+static void onSignal(int)
+{
+    s_bStop = true;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage : solocw-probe [-i interval] [-d duration] [-m metrics file] [-H history size] [-a archive directory] host [host ...]\n");
+    fprintf(stderr, "        solocw-probe -r archive file\n");
+    fprintf(stderr, "  -i interval  seconds between polls of each station (%.2f to %.0f, default %.0f)\n", POLL_INTERVAL_MIN, POLL_INTERVAL_MAX, POLL_INTERVAL_DEFAULT);
+    fprintf(stderr, "  -d duration  seconds to run, 0 runs until interrupted (default 0)\n");
+    fprintf(stderr, "  -m file      export Prometheus metrics to file every %d s\n", ENGINE_METRICS_PERIOD);
+    fprintf(stderr, "  -H samples   history kept per station (%d to %d, default %d)\n", HISTORY_CAPACITY_MIN, HISTORY_CAPACITY_MAX, HISTORY_CAPACITY_DEFAULT);
+    fprintf(stderr, "  -a dir       archive every sample to dir, %d records per station, and keep the last reading there\n", ARCHIVE_CAPACITY_DEFAULT);
+    fprintf(stderr, "  -r file      print the valid records of an archive as CSV and exit\n");
+}
+
+static void printSample(double dTime, const ProbeStation &probe, const WeatherSnapshot &snapshot)
+{
+    const SoloCloudwatcherRecord &record = snapshot.record;
+
+    printf("%.3f,%s,%u,%.1f,%.2f,%.2f,%.2f,%.2f,%d,%.2f,%d\n", dTime, probe.sHost.c_str(), probe.nVersion, snapshot.dRequestTime,
+           record.dSkyTemp, record.dTemp, record.dWindSpeed, record.dWindGust,
+           record.nPercentHumdity, record.dBarometricPressure, record.nOverallConditionSafe);
+}
+
+static int dumpArchive(const char *pszPath)
+{
+    std::vector<ArchiveRecord> records;
+    size_t i;
+
+    if(CSampleArchive::load(std::string(pszPath), records)) {
+        fprintf(stderr, "%s : not a sample archive\n", pszPath);
+        return 1;
+    }
+
+    printf("sequence,generation,time_ms,sky_temp,ambient_temp,wind,gust,humidity,dew_point,pressure,safe,field_mask\n");
+    for(i = 0; i < records.size(); i++) {
+        const HistorySample &sample = records[i].sample;
+        printf("%llu,%u,%lld,%.2f,%.2f,%.2f,%.2f,%d,%.2f,%.2f,%d,0x%04x\n", (unsigned long long)records[i].nSequence, records[i].nGeneration,
+               (long long)sample.nTimeMs, sample.dSkyTemp, sample.dTemp, sample.dWindSpeed, sample.dWindGust,
+               sample.nPercentHumdity, sample.dDewPointTemp, sample.dBarometricPressure, int(sample.nOverallConditionSafe), (unsigned int)sample.nFieldMask);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<ProbeStation> stations;
+    ProbeStation probe;
+    WeatherSnapshot snapshot;
+    PollSchedulerStats stats;
+    HistoryStats skyStats;
+    HistoryStats gustStats;
+    int64_t nNowMs;
+    double dInterval = POLL_INTERVAL_DEFAULT;
+    double dDuration = 0;
+    double dTime;
+    uint32_t nVersion;
+    int nErr;
+    int i;
+    size_t j;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-i") && i + 1 < argc)
+            dInterval = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+            dDuration = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-m") && i + 1 < argc)
+            CStationEngine::instance().setMetricsFile(std::string(argv[++i]));
+        else if(!strcmp(argv[i], "-H") && i + 1 < argc)
+            CStationRegistry::instance().setHistoryCapacity(size_t(atol(argv[++i])));
+        else if(!strcmp(argv[i], "-a") && i + 1 < argc)
+            CStationRegistry::instance().setArchive(std::string(argv[++i]), ARCHIVE_CAPACITY_DEFAULT);
+        else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+            return dumpArchive(argv[++i]);
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            probe.sHost.assign(argv[i]);
+            stations.push_back(probe);
+        }
+    }
+    if(stations.empty()) {
+        usage();
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // the same host given twice shares one station, exactly like two plugin instances would
+    for(j = 0; j < stations.size(); j++) {
+        stations[j].pStation = CStationRegistry::instance().acquire(stations[j].sHost, nErr);
+        if(!stations[j].pStation) {
+            fprintf(stderr, "%s : connection failed, error %d\n", stations[j].sHost.c_str(), nErr);
+            continue;
+        }
+        stations[j].pStation->setPollInterval(dInterval);
+        stations[j].nVersion = 0;
+        stations[j].nSamples = 0;
+    }
+
+    printf("time_s,host,version,request_ms,sky_temp,ambient_temp,wind,gust,humidity,pressure,safe\n");
+    fflush(stdout);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(!s_bStop) {
+        dTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(dDuration > 0 && dTime >= dDuration)
+            break;
+
+        for(j = 0; j < stations.size(); j++) {
+            if(!stations[j].pStation)
+                continue;
+            nVersion = stations[j].pStation->getSnapshot(snapshot);
+            if(nVersion == stations[j].nVersion)
+                continue;
+            stations[j].nVersion = nVersion;
+            stations[j].nSamples++;
+            printSample(dTime, stations[j], snapshot);
+        }
+        fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(PROBE_CHECK_PERIOD));
+    }
+
+    // per station scheduling summary on stderr so stdout stays plain CSV
+    for(j = 0; j < stations.size(); j++) {
+        if(!stations[j].pStation)
+            continue;
+        CPollMetrics &metrics = stations[j].pStation->getMetrics();
+        stations[j].pStation->getPollSchedulerStats(stats);
+        fprintf(stderr, "%s : %llu samples, %llu polls, %llu missed deadlines, lateness mean %.2f ms stddev %.2f ms max %.2f ms, poll max %.2f ms, %.1f s since good data\n",
+                stations[j].sHost.c_str(), (unsigned long long)stations[j].nSamples,
+                (unsigned long long)stats.nPolls, (unsigned long long)stats.nMissedDeadlines,
+                stats.dMeanLateness, stats.dStdDevLateness, stats.dMaxLateness, stats.dMaxDuration,
+                stations[j].pStation->getSecondOfGoodData());
+        fprintf(stderr, "%s : request p50 %.1f ms p99 %.1f ms, deadline %.0f ms, %llu transfer errors, %llu timeouts, %llu parse errors, %llu unchanged samples\n",
+                stations[j].sHost.c_str(), metrics.quantile(PHASE_TOTAL, 0.5), metrics.quantile(PHASE_TOTAL, 0.99), stations[j].pStation->getRequestTimeout(),
+                (unsigned long long)metrics.getErrorCount(POLL_ERROR_TRANSFER), (unsigned long long)metrics.getErrorCount(POLL_ERROR_TIMEOUT),
+                (unsigned long long)metrics.getErrorCount(POLL_ERROR_PARSE), (unsigned long long)metrics.getUnchangedCount());
+        fprintf(stderr, "%s : link %s, %llu state changes, %u failed polls in a row\n",
+                stations[j].sHost.c_str(), CConnectionState::name(stations[j].pStation->getConnectionState()),
+                (unsigned long long)stations[j].pStation->connectionState().getTransitionCount(), stations[j].pStation->connectionState().getFailureCount());
+        if(stations[j].pStation->clockOffset().isValid())
+            fprintf(stderr, "%s : device clock offset %+.0f ms +/- %.0f ms\n", stations[j].sHost.c_str(),
+                    stations[j].pStation->clockOffset().getOffset(), stations[j].pStation->clockOffset().getUncertainty());
+        const CHistoryRing &history = stations[j].pStation->getHistory();
+        nNowMs = CHistoryRing::nowMs();
+        if(history.getStats(HIST_SKY_TEMP, nNowMs - PROBE_TREND_PERIOD, nNowMs, skyStats)) {
+            if(!history.getStats(HIST_WIND_GUST, nNowMs - PROBE_TREND_PERIOD, nNowMs, gustStats))
+                gustStats.dMax = -1;
+            fprintf(stderr, "%s : last %d min, sky temp %.2f to %.2f trend %+.3f /min, max gust %.2f, %llu samples in history\n",
+                    stations[j].sHost.c_str(), PROBE_TREND_PERIOD / 60000, skyStats.dMin, skyStats.dMax, skyStats.dSlope, gustStats.dMax,
+                    (unsigned long long)std::min<uint64_t>(history.getCount(), history.getCapacity()));
+        }
+        CStationRegistry::instance().release(stations[j].pStation);
+    }
+
+    return 0;
+}
@@ -24,15 +24,69 @@ X2WeatherStation::X2WeatherStation(const char* pszDisplayName,
 	m_bLinked = false;
     m_bUiEnabled = false;
 
+    m_sIpAddress = "192.168.0.10";
+    m_dPollInterval = POLL_INTERVAL_DEFAULT;
+    m_bAdaptivePolling = false;
+    m_dAdaptiveMinInterval = ADAPTIVE_INTERVAL_MIN_DEFAULT;
+    m_dAdaptiveMaxInterval = ADAPTIVE_INTERVAL_MAX_DEFAULT;
+    CAdaptivePollRate::defaultLimits(m_AdaptiveLimits);
+    m_nLogLevel = LOG_LEVEL_DEFAULT;
+    m_nLogCategories = LOG_CAT_ALL;
+
     if (m_pIniUtil) {
         char szIpAddress[128];
         m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_IP, "192.168.0.10", szIpAddress, 128);
-        m_SoloCloudwatcher.setIpAddress(std::string(szIpAddress));
+        m_sIpAddress.assign(szIpAddress);
+        m_dPollInterval = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL, POLL_INTERVAL_DEFAULT);
+        m_bAdaptivePolling = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_ADAPTIVE_POLLING, 0) != 0;
+        m_dAdaptiveMinInterval = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL_MIN, ADAPTIVE_INTERVAL_MIN_DEFAULT);
+        m_dAdaptiveMaxInterval = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL_MAX, ADAPTIVE_INTERVAL_MAX_DEFAULT);
+
+        // where the adaptive rate sees each reading turn unsafe, set to match the device's own limits. No UI.
+        m_AdaptiveLimits.dSkyDeltaUnsafe = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_SKY_DELTA_UNSAFE, ADAPTIVE_SKY_DELTA_UNSAFE_DEFAULT);
+        m_AdaptiveLimits.dSkyDeltaMargin = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_SKY_DELTA_MARGIN, ADAPTIVE_SKY_DELTA_MARGIN_DEFAULT);
+        m_AdaptiveLimits.dGustUnsafe = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_GUST_UNSAFE, ADAPTIVE_GUST_UNSAFE_DEFAULT);
+        m_AdaptiveLimits.dGustMargin = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_GUST_MARGIN, ADAPTIVE_GUST_MARGIN_DEFAULT);
+        m_AdaptiveLimits.dHumidityUnsafe = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_HUMIDITY_UNSAFE, ADAPTIVE_HUMIDITY_UNSAFE_DEFAULT);
+        m_AdaptiveLimits.dHumidityMargin = m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_HUMIDITY_MARGIN, ADAPTIVE_HUMIDITY_MARGIN_DEFAULT);
+
+        // optional Prometheus text file with every station's poll metrics, there is no UI for it
+        char szMetricsFile[LOG_BUFFER_SIZE];
+        m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_METRICS_FILE, "", szMetricsFile, LOG_BUFFER_SIZE);
+        if(szMetricsFile[0])
+            CStationEngine::instance().setMetricsFile(std::string(szMetricsFile));
+
+        // samples of history kept per station, no UI either
+        int nSize = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_HISTORY_SIZE, HISTORY_CAPACITY_DEFAULT);
+        CStationRegistry::instance().setHistoryCapacity(nSize > 0 ? size_t(nSize) : 0);
+
+        // on disk archive and last reading so history and data survive restarts, next to the log
+        // unless set. ArchiveSize 0 only turns the archive off.
+        char szArchiveDirectory[LOG_BUFFER_SIZE];
+        m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_ARCHIVE_DIRECTORY, "", szArchiveDirectory, LOG_BUFFER_SIZE);
+        nSize = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_ARCHIVE_SIZE, ARCHIVE_CAPACITY_DEFAULT);
+        CStationRegistry::instance().setArchive(szArchiveDirectory[0] ? std::string(szArchiveDirectory) : CLogger::homeDirectory(),
+                                                nSize > 0 ? size_t(nSize) : 0);
+
+        // the log is process wide, the last instance loaded or configured sets it
+        m_nLogLevel = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_LOG_LEVEL, LOG_LEVEL_DEFAULT);
+        m_nLogCategories = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_LOG_CATEGORIES, LOG_CAT_ALL);
+        CLogger::instance().setLevel(m_nLogLevel);
+        CLogger::instance().setCategories(m_nLogCategories);
     }
+    m_nLogLevel = CLogger::instance().getLevel();
+    m_nLogCategories = CLogger::instance().getCategories();
+    CLogger::instance().open();
+    SOLO_LOG(LOG_CAT_X2, LOG_DEBUG, "[X2WeatherStation] instance %d, log level %d categories 0x%x", m_nPrivateISIndex, m_nLogLevel, m_nLogCategories);
 }
 
 X2WeatherStation::~X2WeatherStation()
 {
+    SOLO_LOG(LOG_CAT_X2, LOG_DEBUG, "[~X2WeatherStation] instance %d", m_nPrivateISIndex);
+    if(m_pSoloCloudwatcher)
+        CStationRegistry::instance().release(m_pSoloCloudwatcher, this);
+    CLogger::instance().close();
+
 	//Delete objects used through composition
 	if (GetSerX())
 		delete GetSerX();
@@ -74,12 +128,10 @@ int X2WeatherStation::execModalSettingsDialog()
     bool bPressedOK = false;
 
     char szTmpBuf[LOG_BUFFER_SIZE];
-    std::stringstream ssTmp;
-    double dTmp;
-    int nTmp;
 
-    std::string sIpAddress;
     std::vector<int> txIds;
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher;
+    WeatherSnapshot snapshot;
 
     m_bUiEnabled = false;
 
@@ -93,54 +145,28 @@ int X2WeatherStation::execModalSettingsDialog()
         return ERR_POINTER;
     }
     X2MutexLocker ml(GetMutex());
-
-    m_SoloCloudwatcher.getIpAddress(sIpAddress);
-    dx->setPropertyString("IPAddress", "text", sIpAddress.c_str());
-
-    if(m_bLinked) {
+    pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
+
+    dx->setPropertyString("IPAddress", "text", m_sIpAddress.c_str());
+    dx->setPropertyDouble("pollInterval", "minimum", POLL_INTERVAL_MIN);
+    dx->setPropertyDouble("pollInterval", "maximum", POLL_INTERVAL_MAX);
+    dx->setPropertyDouble("pollInterval", "value", m_dPollInterval);
+    dx->setChecked("adaptivePolling", m_bAdaptivePolling?1:0);
+    dx->setPropertyDouble("pollIntervalMin", "value", m_dAdaptiveMinInterval);
+    dx->setPropertyDouble("pollIntervalMax", "value", m_dAdaptiveMaxInterval);
+    dx->setCurrentIndex("logLevel", m_nLogLevel);
+    dx->setChecked("logTransport", (m_nLogCategories & (1 << LOG_CAT_TRANSPORT))?1:0);
+    dx->setChecked("logParse", (m_nLogCategories & (1 << LOG_CAT_PARSE))?1:0);
+    dx->setChecked("logPoller", (m_nLogCategories & (1 << LOG_CAT_POLLER))?1:0);
+    dx->setChecked("logX2", (m_nLogCategories & (1 << LOG_CAT_X2))?1:0);
+
+    if(m_bLinked && pSoloCloudwatcher) {
 
         // we can't change the value for the ip and port if we're connected
         dx->setEnabled("IPAddress", false);
         dx->setEnabled("pushButton", true);
-        std::stringstream().swap(ssTmp);
-        ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getAmbianTemp() << " ºC";
-        dx->setPropertyString("temperature", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        nTmp = m_SoloCloudwatcher.getHumidity();
-        if(nTmp>-1)
-            ssTmp<< std::dec << m_SoloCloudwatcher.getHumidity() << " %";
-        else
-            ssTmp <<"N/A";
-        dx->setPropertyString("humidity", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        dTmp = m_SoloCloudwatcher.getDewPointTemp();
-        if(dTmp<100)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getDewPointTemp() << " ºC";
-        else
-            ssTmp <<"N/A";
-        dx->setPropertyString("dewPoint", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getBarometricPressure() << " mbar";
-        dx->setPropertyString("pressure", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        dTmp = m_SoloCloudwatcher.getWindSpeed();
-        if(dTmp >-1)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getWindSpeed() << " km/h";
-        else
-            ssTmp <<"N/A";
-        dx->setPropertyString("windSpeed", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        dTmp = m_SoloCloudwatcher.getWindGust();
-        if(dTmp >-1)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getWindGust() << " km/h";
-        else
-            ssTmp <<"N/A";
-        dx->setPropertyString("windGust", "text", ssTmp.str().c_str());
+        if(pSoloCloudwatcher->peekSnapshot(snapshot))
+            updateWeatherFields(dx, snapshot);
     }
     else {
         dx->setEnabled("IPAddress", true);
@@ -156,11 +182,41 @@ int X2WeatherStation::execModalSettingsDialog()
 
     //Retreive values from the user interface
     if (bPressedOK) {
+        // the poll interval can be changed while connected, the poller picks it up on its next deadline
+        dx->propertyDouble("pollInterval", "value", m_dPollInterval);
+        m_bAdaptivePolling = dx->isChecked("adaptivePolling") != 0;
+        dx->propertyDouble("pollIntervalMin", "value", m_dAdaptiveMinInterval);
+        dx->propertyDouble("pollIntervalMax", "value", m_dAdaptiveMaxInterval);
+        if(pSoloCloudwatcher)
+            applyPollSettings(pSoloCloudwatcher);
+
+        nErr |= m_pIniUtil->writeDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL, m_dPollInterval);
+        nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_ADAPTIVE_POLLING, m_bAdaptivePolling?1:0);
+        nErr |= m_pIniUtil->writeDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL_MIN, m_dAdaptiveMinInterval);
+        nErr |= m_pIniUtil->writeDouble(PARENT_KEY, CHILD_KEY_POLL_INTERVAL_MAX, m_dAdaptiveMaxInterval);
+
+        // logging changes apply right away, connected or not
+        m_nLogLevel = dx->currentIndex("logLevel");
+        m_nLogCategories = 0;
+        if(dx->isChecked("logTransport"))
+            m_nLogCategories |= 1 << LOG_CAT_TRANSPORT;
+        if(dx->isChecked("logParse"))
+            m_nLogCategories |= 1 << LOG_CAT_PARSE;
+        if(dx->isChecked("logPoller"))
+            m_nLogCategories |= 1 << LOG_CAT_POLLER;
+        if(dx->isChecked("logX2"))
+            m_nLogCategories |= 1 << LOG_CAT_X2;
+        CLogger::instance().setLevel(m_nLogLevel);
+        CLogger::instance().setCategories(m_nLogCategories);
+        m_nLogLevel = CLogger::instance().getLevel();
+        nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_LOG_LEVEL, m_nLogLevel);
+        nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_LOG_CATEGORIES, m_nLogCategories);
+
         if(!m_bLinked) {
             // save the values to persistent storage
             dx->propertyString("IPAddress", "text", szTmpBuf, 128);
             nErr |= m_pIniUtil->writeString(PARENT_KEY, CHILD_KEY_IP, szTmpBuf);
-            m_SoloCloudwatcher.setIpAddress(std::string(szTmpBuf));
+            m_sIpAddress.assign(szTmpBuf);
 
         }
     }
@@ -169,56 +225,66 @@ int X2WeatherStation::execModalSettingsDialog()
 
 void X2WeatherStation::uiEvent(X2GUIExchangeInterface* uiex, const char* pszEvent)
 {
-    std::stringstream ssTmp;
-    double dTmp;
-    int nTmp;
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher;
+    WeatherSnapshot snapshot;
 
     // the test for m_bUiEnabled is done because even if the UI is not displayed we get events on the comboBox changes when we fill it.
     if(!m_bLinked | !m_bUiEnabled)
         return;
 
 
-    if (!strcmp(pszEvent, "on_timer") && m_bLinked) {
-        ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getAmbianTemp() << " ºC";
-        uiex->setPropertyString("temperature", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        nTmp = m_SoloCloudwatcher.getHumidity();
-        if(nTmp>-1)
-            ssTmp<< std::dec << m_SoloCloudwatcher.getHumidity() << " %";
-        else
-            ssTmp <<"N/A";
-        uiex->setPropertyString("humidity", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        dTmp = m_SoloCloudwatcher.getDewPointTemp();
-        if(dTmp<100)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getDewPointTemp() << " ºC";
-        else
-            ssTmp <<"N/A";
-        uiex->setPropertyString("dewPoint", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getBarometricPressure() << " mbar";
-        uiex->setPropertyString("pressure", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        dTmp = m_SoloCloudwatcher.getWindSpeed();
-        if(dTmp >-1)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getWindSpeed() << " km/h";
-        else
-            ssTmp <<"N/A";
-        uiex->setPropertyString("windSpeed", "text", ssTmp.str().c_str());
-
-        std::stringstream().swap(ssTmp);
-        if(dTmp >-1)
-            ssTmp<< std::fixed << std::setprecision(2) << m_SoloCloudwatcher.getWindGust() << " km/h";
-        else
-            ssTmp <<"N/A";
-        uiex->setPropertyString("windGust", "text", ssTmp.str().c_str());
+    pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
+    if (!strcmp(pszEvent, "on_timer") && pSoloCloudwatcher) {
+        if(pSoloCloudwatcher->peekSnapshot(snapshot))
+            updateWeatherFields(uiex, snapshot);
     }
 }
 
+// All fields come from the same snapshot, one the device stopped sending shows as N/A. Values
+// are formatted by hand, like the parser reads them, so the host application's numeric locale
+// can't change the decimal separator.
+void X2WeatherStation::updateWeatherFields(X2GUIExchangeInterface* uiex, const WeatherSnapshot &snapshot)
+{
+    char szTmp[UI_FIELD_SIZE];
+    const SoloCloudwatcherRecord &record = snapshot.record;
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_TEMP))
+        CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dTemp, " ºC");
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("temperature", "text", szTmp);
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_HUM) && record.nPercentHumdity>-1)
+        snprintf(szTmp, sizeof(szTmp), "%d %%", record.nPercentHumdity);
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("humidity", "text", szTmp);
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_DEWP) && record.dDewPointTemp<100)
+        CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dDewPointTemp, " ºC");
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("dewPoint", "text", szTmp);
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_RELPRESS))
+        CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dBarometricPressure, " mbar");
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("pressure", "text", szTmp);
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_WIND) && record.dWindSpeed >-1)
+        CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dWindSpeed, " km/h");
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("windSpeed", "text", szTmp);
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_GUST) && record.dWindGust >-1)
+        CCloudwatcherParser::formatFixed2(szTmp, sizeof(szTmp), record.dWindGust, " km/h");
+    else
+        strcpy(szTmp, "N/A");
+    uiex->setPropertyString("windGust", "text", szTmp);
+}
+
 void X2WeatherStation::driverInfoDetailedInfo(BasicStringInterface& str) const
 {
     str = "Solo Cloudwatcher X2 plugin by Rodolphe Pineau";
@@ -246,11 +312,12 @@ void X2WeatherStation::deviceInfoDetailedDescription(BasicStringInterface& str)
 
 void X2WeatherStation::deviceInfoFirmwareVersion(BasicStringInterface& str)
 {
-    if(m_bLinked) {
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
+
+    if(m_bLinked && pSoloCloudwatcher) {
         str = "N/A";
         std::string sFirmware;
-        X2MutexLocker ml(GetMutex());
-        m_SoloCloudwatcher.getFirmware(sFirmware);
+        pSoloCloudwatcher->getFirmware(sFirmware);
         str = sFirmware.c_str();
     }
     else
@@ -267,27 +334,81 @@ int	X2WeatherStation::establishLink(void)
 {
     int nErr = SB_OK;
 
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher;
+
     X2MutexLocker ml(GetMutex());
-    nErr = m_SoloCloudwatcher.Connect();
-    if(nErr)
+    SOLO_LOG(LOG_CAT_X2, LOG_DEBUG, "[establishLink] instance %d, linked : %s", m_nPrivateISIndex, m_bLinked?"Yes":"No");
+    if(m_bLinked)
+        return SB_OK;
+
+    // another instance may already be polling this device, we then share its station
+    pSoloCloudwatcher = CStationRegistry::instance().acquire(m_sIpAddress, nErr);
+    if(nErr) {
+        SOLO_LOG(LOG_CAT_X2, LOG_ERROR, "[establishLink] connection to %s failed, error %d", m_sIpAddress.c_str(), nErr);
         m_bLinked = false;
-    else
-        m_bLinked = true;
+        return x2Error(nErr);
+    }
+
+    applyPollSettings(pSoloCloudwatcher);
+    std::atomic_store(&m_pSoloCloudwatcher, pSoloCloudwatcher);
+    m_bLinked = true;
 
 	return nErr;
 }
 int	X2WeatherStation::terminateLink(void)
 {
-    m_SoloCloudwatcher.Disconnect();
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher;
 
+    X2MutexLocker ml(GetMutex());
+    SOLO_LOG(LOG_CAT_X2, LOG_DEBUG, "[terminateLink] instance %d", m_nPrivateISIndex);
 	m_bLinked = false;
+    pSoloCloudwatcher = std::atomic_exchange(&m_pSoloCloudwatcher, std::shared_ptr<CSoloCloudwatcher>());
+    // the station is only disconnected once the last instance using it lets go
+    CStationRegistry::instance().release(pSoloCloudwatcher, this);
+
 	return SB_OK;
 }
 
+// the core library has its own error codes so it doesn't depend on the TheSkyX SDK
+int X2WeatherStation::x2Error(int nErr)
+{
+    switch(nErr) {
+        case PLUGIN_OK:
+            return SB_OK;
+        case NOT_CONNECTED:
+        case CANT_CONNECT:
+            return ERR_COMMNOLINK;
+        default:
+            return ERR_CMDFAILED;
+    }
+}
+
+// the station runs the combined settings of every instance sharing it, ours are kept as asked, clamped
+void X2WeatherStation::applyPollSettings(const std::shared_ptr<CSoloCloudwatcher> &pSoloCloudwatcher)
+{
+    PollSettings settings;
+
+    settings.dInterval = m_dPollInterval;
+    settings.bAdaptive = m_bAdaptivePolling;
+    settings.dMinInterval = m_dAdaptiveMinInterval;
+    settings.dMaxInterval = m_dAdaptiveMaxInterval;
+    settings.limits = m_AdaptiveLimits;
+    CStationRegistry::instance().setPollSettings(pSoloCloudwatcher, this, settings);
+    m_dPollInterval = settings.dInterval;
+    m_dAdaptiveMinInterval = settings.dMinInterval;
+    m_dAdaptiveMaxInterval = settings.dMaxInterval;
+    m_AdaptiveLimits = settings.limits;
+}
+
 
+// the station stays linked while it retries, only Disconnect closes it
 bool X2WeatherStation::isLinked(void) const
 {
-	return m_bLinked;
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
+
+    if(!m_bLinked || !pSoloCloudwatcher)
+        return false;
+	return pSoloCloudwatcher->getConnectionState() != CONNECTION_CLOSED;
 }
 
 
@@ -312,37 +433,75 @@ int X2WeatherStation::weatherStationData(double& dSkyTemp,
 {
     int nErr = SB_OK;
     int nTmp;
+    int nState;
     double dTmp;
+    WeatherSnapshot snapshot;
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
 
-    if(!m_bLinked)
+    if(!m_bLinked || !pSoloCloudwatcher)
         return ERR_NOLINK;
 
-    X2MutexLocker ml(GetMutex());
+    // No TheSkyX mutex here : the last published poll is copied lock free,
+    // so a slow device or a link-up in progress can't stall weather queries.
+    nState = pSoloCloudwatcher->getConnectionState();
+    if(nState == CONNECTION_CLOSED)
+        return ERR_NOLINK;
+    if(!pSoloCloudwatcher->peekSnapshot(snapshot)) {
+        SOLO_LOG(LOG_CAT_X2, LOG_ERROR, "[weatherStationData] no data published yet, link %s", CConnectionState::name(nState));
+        return ERR_CMDFAILED;
+    }
+    if(nState != CONNECTION_LIVE)
+        SOLO_LOG(LOG_CAT_X2, LOG_DEBUG, "[weatherStationData] link %s, serving the last reading", CConnectionState::name(nState));
 
-    nSecondsSinceGoodData = int(std::round(m_SoloCloudwatcher.getSecondOfGoodData()));
-    dSkyTemp = m_SoloCloudwatcher.getSkyTemp();
-    dAmbTemp = m_SoloCloudwatcher.getAmbianTemp();
-    
-    dTmp = m_SoloCloudwatcher.getWindSpeed();
-    if(dTmp >-1)
+    // time since the sensors were read, not since the last poll, the roof closes on it
+    nSecondsSinceGoodData = int(std::round(pSoloCloudwatcher->getSecondOfGoodData()));
+
+    // Field by field : a reading the device stopped sending is left out, a condition is
+    // reported as unknown and a missing safe flag closes the roof.
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_CLOUDS))
+        dSkyTemp = snapshot.record.dSkyTemp;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_TEMP))
+        dAmbTemp = snapshot.record.dTemp;
+
+    dTmp = snapshot.record.dWindSpeed;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_WIND) && dTmp >-1)
         dWind = dTmp;
 
-    nTmp = m_SoloCloudwatcher.getHumidity();
-    if(nTmp>-1)
+    nTmp = snapshot.record.nPercentHumdity;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_HUM) && nTmp>-1)
         nPercentHumdity = nTmp;
 
-    dTmp = m_SoloCloudwatcher.getDewPointTemp();
-    if(dTmp<100)
+    dTmp = snapshot.record.dDewPointTemp;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_DEWP) && dTmp<100)
         dDewPointTemp = dTmp;
-    
-    dBarometricPressure = m_SoloCloudwatcher.getBarometricPressure();
 
-    cloudCondition = (WeatherStationDataInterface::x2CloudCond)m_SoloCloudwatcher.getCloudCondition();
-    windCondition = (WeatherStationDataInterface::x2WindCond)m_SoloCloudwatcher.getWindCondition();
-    rainCondition = (WeatherStationDataInterface::x2RainCond)m_SoloCloudwatcher.getRainCondition();
-    daylightCondition = (WeatherStationDataInterface::x2DayCond)m_SoloCloudwatcher.getLightCondition();
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_RELPRESS))
+        dBarometricPressure = snapshot.record.dBarometricPressure;
+
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_CLOUDS_SAFE))
+        cloudCondition = (WeatherStationDataInterface::x2CloudCond)snapshot.record.nCloudCondition;
+    else
+        cloudCondition = WeatherStationDataInterface::cloudUnknown;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_WIND_SAFE))
+        windCondition = (WeatherStationDataInterface::x2WindCond)snapshot.record.nWindCondition;
+    else
+        windCondition = WeatherStationDataInterface::windUnknown;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_RAIN_SAFE))
+        rainCondition = (WeatherStationDataInterface::x2RainCond)snapshot.record.nRainCondition;
+    else
+        rainCondition = WeatherStationDataInterface::rainUnknown;
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_LIGHT_SAFE))
+        daylightCondition = (WeatherStationDataInterface::x2DayCond)snapshot.record.nLightCondition;
+    else
+        daylightCondition = WeatherStationDataInterface::dayUnknown;
+
+    // solo cloudwatcher report 0 for unsafe, 1 for safe
+    if(CSoloCloudwatcher::isFieldCurrent(snapshot, FIELD_SAFE))
+        nRoofCloseThisCycle = snapshot.record.nOverallConditionSafe==0?1:0;
+    else
+        nRoofCloseThisCycle = 1;
 
-    nRoofCloseThisCycle = m_SoloCloudwatcher.getSafeCondition()==0?1:0; // solo cloudwatcher report 0 for unsafe, 1 for safe
+    SOLO_LOG(LOG_CAT_X2, LOG_TRACE, "[weatherStationData] sky : %g temp : %g safe : %d seconds since good data : %d", dSkyTemp, dAmbTemp, snapshot.record.nOverallConditionSafe, nSecondsSinceGoodData);
 
 	return nErr;
 }
@@ -350,10 +509,12 @@ int X2WeatherStation::weatherStationData(double& dSkyTemp,
 WeatherStationDataInterface::x2WindSpeedUnit X2WeatherStation::windSpeedUnit()
 {
     WeatherStationDataInterface::x2WindSpeedUnit nUnit = WeatherStationDataInterface::x2WindSpeedUnit::windSpeedKph;
-    int SoloCloudwatcherUnit;
+    int SoloCloudwatcherUnit = KPH;
     std::stringstream tmp;
+    std::shared_ptr<CSoloCloudwatcher> pSoloCloudwatcher = std::atomic_load(&m_pSoloCloudwatcher);
 
-    SoloCloudwatcherUnit = m_SoloCloudwatcher.getWindSpeedUnit(SoloCloudwatcherUnit);
+    if(pSoloCloudwatcher)
+        SoloCloudwatcherUnit = pSoloCloudwatcher->getWindSpeedUnit(SoloCloudwatcherUnit);
 
     switch(SoloCloudwatcherUnit) {
         case KPH:
@@ -5,6 +5,7 @@
 
 #include <string.h>
 #include <iterator>
+#include <atomic>
 
 #include "../../licensedinterfaces/theskyxfacadefordriversinterface.h"
 #include "../../licensedinterfaces/sleeperinterface.h"
@@ -24,10 +25,28 @@
 
 
 #include "SoloCloudwatcher.h"
+#include "StationRegistry.h"
 
 #define PARENT_KEY      "SoloCloudwatcher"
 #define CHILD_KEY_IP    "IPAddress"
+#define CHILD_KEY_POLL_INTERVAL "PollInterval"
+#define CHILD_KEY_ADAPTIVE_POLLING  "AdaptivePolling"
+#define CHILD_KEY_POLL_INTERVAL_MIN "PollIntervalMin"
+#define CHILD_KEY_POLL_INTERVAL_MAX "PollIntervalMax"
+#define CHILD_KEY_SKY_DELTA_UNSAFE  "AdaptiveSkyDeltaUnsafe"
+#define CHILD_KEY_SKY_DELTA_MARGIN  "AdaptiveSkyDeltaMargin"
+#define CHILD_KEY_GUST_UNSAFE       "AdaptiveGustUnsafe"
+#define CHILD_KEY_GUST_MARGIN       "AdaptiveGustMargin"
+#define CHILD_KEY_HUMIDITY_UNSAFE   "AdaptiveHumidityUnsafe"
+#define CHILD_KEY_HUMIDITY_MARGIN   "AdaptiveHumidityMargin"
+#define CHILD_KEY_METRICS_FILE      "MetricsFile"
+#define CHILD_KEY_HISTORY_SIZE      "HistorySize"
+#define CHILD_KEY_ARCHIVE_DIRECTORY "ArchiveDirectory"
+#define CHILD_KEY_ARCHIVE_SIZE      "ArchiveSize"
+#define CHILD_KEY_LOG_LEVEL         "LogLevel"
+#define CHILD_KEY_LOG_CATEGORIES    "LogCategories"
 #define LOG_BUFFER_SIZE 8192
+#define UI_FIELD_SIZE   64
 
 // Forward declare the interfaces that this device is dependent upon
 class SerXInterface;
@@ -149,11 +168,27 @@ private:
 
 
     int     m_nPrivateISIndex;
-	bool    m_bLinked;
+	std::atomic<bool>   m_bLinked;
 
     bool    m_bUiEnabled;
 
-    CSoloCloudwatcher        m_SoloCloudwatcher;
+    // shared with any other instance using the same device, only set while linked.
+    // Accessed with std::atomic_load/atomic_store as weatherStationData doesn't take the mutex.
+    std::shared_ptr<CSoloCloudwatcher>  m_pSoloCloudwatcher;
+
+    // settings are kept here and applied to the station on link
+    std::string     m_sIpAddress;
+    double          m_dPollInterval;
+    bool            m_bAdaptivePolling;
+    double          m_dAdaptiveMinInterval;
+    double          m_dAdaptiveMaxInterval;
+    AdaptiveLimits  m_AdaptiveLimits;
+    int             m_nLogLevel;
+    int             m_nLogCategories;
+
+    void    applyPollSettings(const std::shared_ptr<CSoloCloudwatcher> &pSoloCloudwatcher);
+    static int  x2Error(int nErr);
+    void    updateWeatherFields(X2GUIExchangeInterface* uiex, const WeatherSnapshot &snapshot);
 
 };
 